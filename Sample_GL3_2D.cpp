@@ -1,8 +1,16 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <stdlib.h>
 #include <cmath>
 #include <fstream>
+#include <memory>
+#include <random>
 #include <vector>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <string>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -10,116 +18,64 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <glad/glad.h>
-#include <FTGL/ftgl.h>
 #include <GLFW/glfw3.h>
-#include <SOIL/SOIL.h>
 
-using namespace std;
-
-struct VAO {
-    GLuint VertexArrayID;
-    GLuint VertexBuffer;
-    GLuint ColorBuffer;
-    GLuint TextureBuffer;
-    GLuint TextureID;
+#include "assetloader.h"
+#include "benchmark.h"
+#include "camera.h"
+#include "gamestate.h"
+#include "inputlog.h"
+#include "offscreen.h"
+#include "pak.h"
+#include "globjects.h"
+#include "gputimer.h"
+#include "profiler.h"
+#include "renderqueue.h"
+#include "resources.h"
+#include "sprites.h"
+#include "startup.h"
+#include "textrenderer.h"
 
-    GLenum PrimitiveMode; // GL_POINTS, GL_LINE_STRIP, GL_LINE_LOOP, GL_LINES, GL_LINE_STRIP_ADJACENCY, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES, GL_TRIANGLE_STRIP_ADJACENCY and GL_TRIANGLES_ADJACENCY
-    GLenum FillMode; // GL_FILL, GL_LINE
-    int NumVertices;
-};
-typedef struct VAO VAO;
+using namespace std;
 
 struct GLMatrices {
     glm::mat4 projection;
     glm::mat4 model;
     glm::mat4 view;
-    GLuint MatrixID; // For use with normal shader
-    GLuint TexMatrixID; // For use with texture shader
 } Matrices;
 
-struct FTGLFont {
-    FTFont* font;
-    GLuint fontMatrixID;
-    GLuint fontColorID;
-} GL3Font;
+// Uniform and attribute locations are resolved by each Program when it is linked
+const Program *colorProgram, *textProgram, *spriteProgram, *tileProgram;
 
-GLuint programID, fontProgramID, textureProgramID;
+GlyphAtlas* hudFont;
+SpriteAtlas* uiAtlas; // Every background, icon and flat quad of the 2D screens
 
-/* Function to load Shaders - Use it as it is */
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
-{
+// 2D elements of every screen, one draw and one texture binding each
+SpriteBatch startSprites, controlsSprites, loadingSprites, hudSprites, endSprites;
+int startHoverSlot, controlsHoverSlot, endHoverSlot, dotSlot, loadingBarSlot, healthBarSlot;
+int lifeSlots[3];
 
-    // Create the shaders
-    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Read the Vertex Shader code from the file
-    std::string VertexShaderCode;
-    std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-    if (VertexShaderStream.is_open()) {
-        std::string Line = "";
-        while (getline(VertexShaderStream, Line))
-            VertexShaderCode += "\n" + Line;
-        VertexShaderStream.close();
-    }
+// Text of every screen, built once and only rebuilt when a value changes
+TextBatch startText, controlsText, hudText, endText, profileText;
+int scoreSlot, levelSlot, livesSlot, timeSlot, endScoreSlot;
+int profileSlots[PROFILE_PHASES + 1][2]; // CPU and GPU columns of each phase, then the frame
 
-    // Read the Fragment Shader code from the file
-    std::string FragmentShaderCode;
-    std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-    if (FragmentShaderStream.is_open()) {
-        std::string Line = "";
-        while (getline(FragmentShaderStream, Line))
-            FragmentShaderCode += "\n" + Line;
-        FragmentShaderStream.close();
-    }
+/* Queue a colored VAO drawn with the normal shaders */
+void submitMesh(RenderLayer layer, struct VAO* vao, const glm::mat4& MVP)
+{
+    renderQueue.submit(DrawItem::mesh(layer, colorProgram->id(), colorProgram->location(UNIFORM_MVP), vao, MVP));
+}
 
-    GLint Result = GL_FALSE;
-    int InfoLogLength;
-
-    // Compile Vertex Shader
-    //	cout << "Compiling shader : " <<  vertex_file_path << endl;
-    char const* VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
-    glCompileShader(VertexShaderID);
-
-    // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    std::vector<char> VertexShaderErrorMessage(max(InfoLogLength, int(1)));
-    glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-    //	cout << VertexShaderErrorMessage.data() << endl;
-
-    // Compile Fragment Shader
-    //	cout << "Compiling shader : " << fragment_file_path << endl;
-    char const* FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
-    glCompileShader(FragmentShaderID);
-
-    // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    std::vector<char> FragmentShaderErrorMessage(max(InfoLogLength, int(1)));
-    glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-    //	cout << FragmentShaderErrorMessage.data() << endl;
-    // Link the program
-    //	cout << "Linking program" << endl;
-    GLuint ProgramID = glCreateProgram();
-    glAttachShader(ProgramID, VertexShaderID);
-
-    glAttachShader(ProgramID, FragmentShaderID);
-    glLinkProgram(ProgramID);
-
-    // Check the program
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-    glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    std::vector<char> ProgramErrorMessage(max(InfoLogLength, int(1)));
-    glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-    //	cout << ProgramErrorMessage.data() << endl;
-
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
-
-    return ProgramID;
+/* Queue all the sprites of a batch as one draw with the sprite shaders */
+void submitSprites(RenderLayer layer, SpriteBatch& batch, const glm::mat4& VP)
+{
+    renderQueue.submit(DrawItem::textured(layer, spriteProgram->id(), spriteProgram->location(UNIFORM_MVP), batch.prepare(*uiAtlas), VP, GL_TEXTURE_2D_ARRAY));
+}
+
+/* Queue all the strings of a batch as one draw with the text shaders */
+void submitText(TextBatch& batch, const glm::mat4& VP)
+{
+    renderQueue.submit(DrawItem::textured(LAYER_TEXT, textProgram->id(), textProgram->location(UNIFORM_MVP), batch.prepare(*hudFont), VP));
 }
 
 static void error_callback(int error, const char* description)
@@ -127,8 +83,30 @@ static void error_callback(int error, const char* description)
     cout << "Error: " << description << endl;
 }
 
+/* Free the cached resources and print what is still alive, anything left is a leak */
+void releaseResources()
+{
+    startText.release();
+    controlsText.release();
+    hudText.release();
+    endText.release();
+    profileText.release();
+    startSprites.release();
+    controlsSprites.release();
+    loadingSprites.release();
+    hudSprites.release();
+    endSprites.release();
+    profiler.release();
+    assetLoader.release();
+    resources.clear();
+    // On stderr, stdout may be carrying --bench results
+    cerr << "GPU objects still alive at exit:" << endl;
+    GpuRegistry::report(cerr);
+}
+
 void quit(GLFWwindow* window)
 {
+    releaseResources();
     glfwDestroyWindow(window);
     glfwTerminate();
     exit(EXIT_SUCCESS);
@@ -154,176 +132,6 @@ glm::vec3 getRGBfromHue(int hue)
         return glm::vec3(1, 0, x);
 }
 
-/* Generate VAO, VBOs and return VAO handle */
-struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode = GL_FILL)
-{
-    struct VAO* vao = new struct VAO;
-    vao->PrimitiveMode = primitive_mode;
-    vao->NumVertices = numVertices;
-    vao->FillMode = fill_mode;
-
-    // Create Vertex Array Object
-    // Should be done after CreateWindow and before any other GL calls
-    glGenVertexArrays(1, &(vao->VertexArrayID)); // VAO
-    glGenBuffers(1, &(vao->VertexBuffer)); // VBO - vertices
-    glGenBuffers(1, &(vao->ColorBuffer)); // VBO - colors
-
-    glBindVertexArray(vao->VertexArrayID); // Bind the VAO
-    glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer); // Bind the VBO vertices
-    glBufferData(GL_ARRAY_BUFFER, 3 * numVertices * sizeof(GLfloat), vertex_buffer_data, GL_STATIC_DRAW); // Copy the vertices into VBO
-    glVertexAttribPointer(
-        0, // attribute 0. Vertices
-        3, // size (x,y,z)
-        GL_FLOAT, // type
-        GL_FALSE, // normalized?
-        0, // stride
-        (void*)0 // array buffer offset
-        );
-
-    glBindBuffer(GL_ARRAY_BUFFER, vao->ColorBuffer); // Bind the VBO colors
-    glBufferData(GL_ARRAY_BUFFER, 3 * numVertices * sizeof(GLfloat), color_buffer_data, GL_STATIC_DRAW); // Copy the vertex colors
-    glVertexAttribPointer(
-        1, // attribute 1. Color
-        3, // size (r,g,b)
-        GL_FLOAT, // type
-        GL_FALSE, // normalized?
-        0, // stride
-        (void*)0 // array buffer offset
-        );
-
-    return vao;
-}
-
-/* Generate VAO, VBOs and return VAO handle - Common Color for all vertices */
-struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode = GL_FILL)
-{
-    GLfloat* color_buffer_data = new GLfloat[3 * numVertices];
-    for (int i = 0; i < numVertices; i++) {
-        color_buffer_data[3 * i] = red;
-        color_buffer_data[3 * i + 1] = green;
-        color_buffer_data[3 * i + 2] = blue;
-    }
-
-    return create3DObject(primitive_mode, numVertices, vertex_buffer_data, color_buffer_data, fill_mode);
-}
-
-struct VAO* create3DTexturedObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* texture_buffer_data, GLuint textureID, GLenum fill_mode = GL_FILL)
-{
-    struct VAO* vao = new struct VAO;
-    vao->PrimitiveMode = primitive_mode;
-    vao->NumVertices = numVertices;
-    vao->FillMode = fill_mode;
-    vao->TextureID = textureID;
-
-    // Create Vertex Array Object
-    // Should be done after CreateWindow and before any other GL calls
-    glGenVertexArrays(1, &(vao->VertexArrayID)); // VAO
-    glGenBuffers(1, &(vao->VertexBuffer)); // VBO - vertices
-    glGenBuffers(1, &(vao->TextureBuffer)); // VBO - textures
-
-    glBindVertexArray(vao->VertexArrayID); // Bind the VAO
-    glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer); // Bind the VBO vertices
-    glBufferData(GL_ARRAY_BUFFER, 3 * numVertices * sizeof(GLfloat), vertex_buffer_data, GL_STATIC_DRAW); // Copy the vertices into VBO
-    glVertexAttribPointer(
-        0, // attribute 0. Vertices
-        3, // size (x,y,z)
-        GL_FLOAT, // type
-        GL_FALSE, // normalized?
-        0, // stride
-        (void*)0 // array buffer offset
-        );
-
-    glBindBuffer(GL_ARRAY_BUFFER, vao->TextureBuffer); // Bind the VBO textures
-    glBufferData(GL_ARRAY_BUFFER, 2 * numVertices * sizeof(GLfloat), texture_buffer_data, GL_STATIC_DRAW); // Copy the vertex colors
-    glVertexAttribPointer(
-        2, // attribute 2. Textures
-        2, // size (s,t)
-        GL_FLOAT, // type
-        GL_FALSE, // normalized?
-        0, // stride
-        (void*)0 // array buffer offset
-        );
-
-    return vao;
-}
-
-/* Render the VBOs handled by VAO */
-void draw3DObject(struct VAO* vao)
-{
-    // Change the Fill Mode for this object
-    glPolygonMode(GL_FRONT_AND_BACK, vao->FillMode);
-
-    // Bind the VAO to use
-    glBindVertexArray(vao->VertexArrayID);
-
-    // Enable Vertex Attribute 0 - 3d Vertices
-    glEnableVertexAttribArray(0);
-    // Bind the VBO to use
-    glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer);
-
-    // Enable Vertex Attribute 1 - Color
-    glEnableVertexAttribArray(1);
-    // Bind the VBO to use
-    glBindBuffer(GL_ARRAY_BUFFER, vao->ColorBuffer);
-
-    // Draw the geometry !
-    glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
-}
-
-void draw3DTexturedObject(struct VAO* vao)
-{
-    // Change the Fill Mode for this object
-    glPolygonMode(GL_FRONT_AND_BACK, vao->FillMode);
-
-    // Bind the VAO to use
-    glBindVertexArray(vao->VertexArrayID);
-
-    // Enable Vertex Attribute 0 - 3d Vertices
-    glEnableVertexAttribArray(0);
-    // Bind the VBO to use
-    glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer);
-
-    // Bind Textures using texture units
-    glBindTexture(GL_TEXTURE_2D, vao->TextureID);
-
-    // Enable Vertex Attribute 2 - Texture
-    glEnableVertexAttribArray(2);
-    // Bind the VBO to use
-    glBindBuffer(GL_ARRAY_BUFFER, vao->TextureBuffer);
-
-    // Draw the geometry !
-    glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
-
-    // Unbind Textures to be safe
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-/* Create an OpenGL Texture from an image */
-GLuint createTexture(const char* filename)
-{
-    GLuint TextureID;
-    // Generate Texture Buffer
-    glGenTextures(1, &TextureID);
-    // All upcoming GL_TEXTURE_2D operations now have effect on our texture buffer
-    glBindTexture(GL_TEXTURE_2D, TextureID);
-    // Set our texture parameters
-    // Set texture wrapping to GL_REPEAT
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // Set texture filtering (interpolation)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Load image and create OpenGL texture
-    int twidth, theight;
-    unsigned char* image = SOIL_load_image(filename, &twidth, &theight, 0, SOIL_LOAD_RGB);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, twidth, theight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D); // Generate MipMaps to use
-    SOIL_free_image_data(image); // Free the data read from file after creating opengl texture
-    glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture when done, so we won't accidentily mess it up
-
-    return TextureID;
-}
 
 /**************************
  * Customizable functions *
@@ -332,40 +140,218 @@ GLuint createTexture(const char* filename)
 int hover_flag = 0;
 int sc_flag = 0;
 float hover_y = 0;
-int score = 0;
-int temp_score = score;
+int temp_score = -1;
 char score_string[3];
 char lives_string[1];
 char time_string[2];
 char level_string[1];
 int score_display_flag = 0;
-int lives = 3;
-int level = 3;
-float loading_time = 0;
+float loading_time = 0; // The loading bar, 0 to 20 as the assets load, over 20 once they are in
+float loading_clock = 0; // Drives the dots, which move whatever the progress
 int init_flag = 0;
 bool pause = false;
-bool jump = false;
-int dir = 1;
-int px = 0;
-int pz = 9;
-float rx = 0;
-float ry = 0;
-int hole[5];
-int tile[5];
-float health = 15;
-float cy = 0;
-int b_m = 0;
-bool on_tile = false;
-int coin_count=0;
-int timer=15;
-int time_c=timer;
+int time_c;
 bool tower_view=false;
 bool top_view=false;
 bool follow_view=false;	
 bool helicopter_view=false;
 bool adventure_view=false;
-int iteration=0,c_i=0,turn=0;
+int turn=0;
 float camera_rotation_angle = 90;
+bool print_render_stats = false;
+
+/* Per-frame counters of the board's chunk culling */
+struct CullStats {
+    int chunksTested;
+    int chunksDrawn;
+} tile_culling;
+bool vsync = true;
+Camera camera;
+
+/* The simulation advances in fixed steps of SIM_DT seconds of real time, */
+/* however many frames are drawn; per-step constants assume this rate */
+const double SIM_DT = 1.0 / 60.0;
+const double MAX_FRAME_TIME = 0.25; // Longest stall that is caught up on, the rest is dropped
+
+/* The part of the simulation the renderer interpolates between steps */
+struct SimSnapshot {
+    float cy, rx, ry, camera_rotation_angle;
+    int px, pz;
+    bool jump;
+};
+SimSnapshot previous_sim, current_sim;
+float sim_alpha = 1; // How far the frame is from previous_sim (0) to current_sim (1)
+double frame_time = 0; // Real seconds since the previous frame
+
+// The game itself, and what the player asked for since the last step
+GameState game;
+GameInputs pending_inputs;
+int board_width = BOARD_WIDTH, board_height = BOARD_HEIGHT;
+
+/* Every game of the session is seeded from the session seed and its number, */
+/* so running again with --seed replays the same sequence of layouts */
+uint64_t session_seed;
+int games_started = 0;
+
+/* With --record every game is logged to record_file (the last one played is */
+/* kept), with --replay the logged game is played instead of the player's */
+const char* record_file = NULL;
+InputRecorder recorder;
+InputLog replay_log;
+bool replaying = false;
+
+/* --bench : the game screen with a fixed seed while the camera goes through */
+/* each view below for bench_seconds, then the frame times as JSON on stdout */
+const char* BENCH_VIEWS[] = { "tower", "top", "follow", "helicopter", "adventure" };
+const int BENCH_VIEW_COUNT = sizeof(BENCH_VIEWS) / sizeof(BENCH_VIEWS[0]);
+const double BENCH_WARMUP = 0.5; // Seconds at the start of each view left out, the camera is still blending
+double bench_seconds = 0; // 0 when not benchmarking
+double bench_time = 0;
+
+/* Put the camera where the script wants it at bench_time; -1 once it is over */
+int benchView()
+{
+    int view = (int)(bench_time / bench_seconds);
+    if (view >= BENCH_VIEW_COUNT)
+        return -1;
+    tower_view = view == 0;
+    top_view = view == 1;
+    follow_view = view == 2;
+    helicopter_view = view == 3;
+    adventure_view = view == 4;
+    // The helicopter goes round once over its time
+    turn = 0;
+    camera_rotation_angle = 90 + 360 * (bench_time - view * bench_seconds) / bench_seconds;
+    return view;
+}
+
+void newGame()
+{
+    if (replaying)
+        replay_log.restart(game);
+    else
+        resetGame(game, board_width, board_height, mixSeed(session_seed, games_started++));
+    if (record_file && !recorder.open(record_file, game))
+        cout << "Could not write the input log " << record_file << endl;
+}
+
+/* World position of a board column and row; tiles are 0.6 apart and the */
+/* board is centred on x = 0 */
+const float TILE_SPACING = 0.6f;
+
+float boardX(float cx)
+{
+    return TILE_SPACING * (cx - game.board.width() / 2.0f);
+}
+
+float boardZ(float cz)
+{
+    return TILE_SPACING * cz;
+}
+
+/* CPU copy of the board's tile instances, 4 floats per cell kept in cell */
+/* index order, CHUNK_CELLS per chunk, and what they were built from */
+struct TileInstances {
+    unsigned revision;
+    std::vector<GLfloat> data;
+    std::vector<uint64_t> holes, moving; // Chunk bits of the last build
+    bool fresh; // Changed since it was last streamed to the GPU
+
+    TileInstances()
+        : revision(~0u)
+        , fresh(false)
+    {
+    }
+} board_tiles;
+
+/* Rebuild the tiles of the chunks whose holes or moving tiles changed, all */
+/* of them if the board changed size. Only reads board, so the loader thread */
+/* can build the first set on a copy while the loading screen is up */
+void updateTileInstances(const Board& board, TileInstances& tiles)
+{
+    if (board.revision() == tiles.revision && (int)tiles.data.size() == 4 * board.cells())
+        return;
+    bool full = (int)tiles.data.size() != 4 * board.cells();
+    if (full) {
+        tiles.data.assign(4 * board.cells(), 0);
+        tiles.holes.assign(board.chunkCount(), 0);
+        tiles.moving.assign(board.chunkCount(), 0);
+    }
+    for (int chunk = 0; chunk < board.chunkCount(); chunk++) {
+        if (!full && board.chunkBits(chunk, CELL_HOLE) == tiles.holes[chunk] && board.chunkBits(chunk, CELL_MOVING) == tiles.moving[chunk])
+            continue;
+        tiles.holes[chunk] = board.chunkBits(chunk, CELL_HOLE);
+        tiles.moving[chunk] = board.chunkBits(chunk, CELL_MOVING);
+        for (int k = 0; k < Board::CHUNK_CELLS; k++) {
+            int cell = chunk * Board::CHUNK_CELLS + k;
+            int cx = board.cellX(cell), cz = board.cellZ(cell);
+            GLfloat* instance = &tiles.data[4 * cell];
+            // boardX of this board, not of the game's
+            instance[0] = TILE_SPACING * (cx - board.width() / 2.0f);
+            instance[1] = boardZ(cz);
+            instance[2] = board.has(cell, CELL_MOVING) ? 1 : 0;
+            // Padding cells past the edge are drawn like holes, i.e. not at all
+            instance[3] = board.has(cell, CELL_HOLE) || !board.inside(cx, cz) ? 1 : 0;
+        }
+    }
+    tiles.revision = board.revision();
+    tiles.fresh = true;
+}
+
+void buildTiles(MeshData& mesh);
+void buildCoins(MeshData& mesh);
+void buildFire(MeshData& mesh);
+void buildPlayer(MeshData& mesh);
+void createGameResources();
+
+/* Go to the loading screen, which stays up until the loader has prepared */
+/* and uploaded what the game and end screens need */
+void startLoading()
+{
+    loading_time = 0;
+    loading_clock = 0;
+    sc_flag = 3;
+    init_flag = 1; // Set up the game screen on the first frame after loading finishes
+    // The game's meshes and program, once per run : their vertices are
+    // merged and shaders read on the loader thread, one upload per frame
+    static bool resources_queued = false;
+    if (!resources_queued) {
+        resources_queued = true;
+        assetLoader.queueMesh("tiles", buildTiles);
+        assetLoader.queueMesh("coin", buildCoins);
+        assetLoader.queueMesh("fire", buildFire);
+        assetLoader.queueMesh("player", buildPlayer);
+        assetLoader.queueProgram("TileInstanced.vert", "Sample_GL3.frag");
+        assetLoader.queue([]() {}, createGameResources);
+    }
+    // The atlas layers of the game and end screens' images
+    const char* images[] = { "lives.jpg", "space4.jpg" };
+    for (int i = 0; i < 2; i++)
+        if (const SpriteAtlas::Sprite* sprite = uiAtlas->sprite(images[i]))
+            assetLoader.queueAtlasLayer(uiAtlas, (int)sprite->layer);
+    // The tile instances of a large board take a while to build
+    shared_ptr<Board> board(new Board(game.board));
+    shared_ptr<TileInstances> tiles(new TileInstances());
+    assetLoader.queue(
+        [=]() { updateTileInstances(*board, *tiles); },
+        [=]() { std::swap(board_tiles, *tiles); });
+}
+
+/* Camera mode picked by the view toggles, in their order of priority */
+CameraMode activeCameraMode()
+{
+    if (tower_view)
+        return CAMERA_TOWER;
+    if (top_view)
+        return CAMERA_TOP;
+    if (follow_view)
+        return CAMERA_FOLLOW;
+    if (helicopter_view)
+        return CAMERA_HELICOPTER;
+    if (adventure_view)
+        return CAMERA_ADVENTURE;
+    return CAMERA_DEFAULT;
+}
 
 /* Executed when a regular key is pressed/released/held-down */
 /* Prefered for Keyboard events */
@@ -397,17 +383,24 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 		turn=-1;
 		camera_rotation_angle=90;
 	break;
+	case GLFW_KEY_F10:
+		// Show where the frame time goes; the benchmark times whole frames itself
+		if (bench_seconds == 0)
+			profiler.setEnabled(!profiler.enabled());
+	break;
+	case GLFW_KEY_F11:
+		// Log the render queue's draws and state changes and the culled chunks every frame
+		print_render_stats = !print_render_stats;
+	break;
+	case GLFW_KEY_F12:
+		// Print the live GPU objects and their memory on demand
+		GpuRegistry::report(cout);
+	break;
 	case GLFW_KEY_F :
-		if(iteration<3){
-			iteration++;
-			c_i=iteration;
-		}
+		pending_inputs.boost = 1;
 	break;
 	case GLFW_KEY_G :
-		if(iteration>1){
-			iteration--;
-			c_i=iteration;
-		}
+		pending_inputs.boost = -1;
 	break;
         case GLFW_KEY_UP:
             if (sc_flag == 0) {
@@ -420,11 +413,9 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
                 if (hover_flag < 5)
                     hover_flag = 6;
             }
-            else if (sc_flag == 3 && loading_time > 20 && !jump) {
-                pz--;
-		if(on_tile && cy<=ry)
-			pz++;
-                dir = 1;
+            else if (sc_flag == 3 && loading_time > 20) {
+                pending_inputs.face = DIR_UP;
+                pending_inputs.move = DIR_UP;
             }
             break;
         case GLFW_KEY_DOWN:
@@ -439,27 +430,21 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
                     hover_flag = 5;
                 }
             }
-            else if (sc_flag == 3 && loading_time > 20 && !jump ) {
-                pz++;
-		if(on_tile && cy<=ry)
-			pz--;
-                dir = 4;
+            else if (sc_flag == 3 && loading_time > 20) {
+                pending_inputs.face = DIR_DOWN;
+                pending_inputs.move = DIR_DOWN;
             }
             break;
         case GLFW_KEY_LEFT:
-            if (sc_flag == 3 && loading_time > 20 && !jump) {
-                px--;
-		if(on_tile && cy<=ry)
-			px++;
-                dir = 2;
+            if (sc_flag == 3 && loading_time > 20) {
+                pending_inputs.face = DIR_LEFT;
+                pending_inputs.move = DIR_LEFT;
             }
             break;
         case GLFW_KEY_RIGHT:
-            if (sc_flag == 3 && loading_time > 20 && !jump) {
-                px++;
-		if(on_tile && cy<=ry)
-			px--;
-                dir = 3;
+            if (sc_flag == 3 && loading_time > 20) {
+                pending_inputs.face = DIR_RIGHT;
+                pending_inputs.move = DIR_RIGHT;
             }
             break;
         case GLFW_KEY_ENTER:
@@ -467,16 +452,9 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
                 if (hover_flag == 2)
                     quit(window);
                 else if (hover_flag == 0) {
-                    lives = 3;
-                    level = 1;
-                    loading_time = 0;
-                    sc_flag = 3;
-                    px = 0;
-                    pz = 9;
-                    score = 0;
+                    newGame();
+                    startLoading();
                //     pause = false;
-                    jump = false;
-                    dir = 1;
                 }
                 else if (hover_flag == 1)
                     sc_flag = 1;
@@ -485,16 +463,13 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
                 if (hover_flag == 6) {
                     quit(window);
                 }
-                else if (hover_flag == 5)
-                    lives = 3;
-                level = 1;
                 loading_time = 0;
                 sc_flag = 0;
                 hover_flag = 0;
             }
             break;
         case GLFW_KEY_SPACE:
-            jump = true;
+            pending_inputs.jump = true;
             break;
         case GLFW_KEY_BACKSPACE:
             if (hover_flag == 1)
@@ -505,20 +480,20 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
                 pause = !pause;
             break;
         case GLFW_KEY_W:
-            if (sc_flag == 3 && loading_time > 20 && !jump)
-                dir = 1;
+            if (sc_flag == 3 && loading_time > 20)
+                pending_inputs.face = DIR_UP;
             break;
         case GLFW_KEY_S:
-            if (sc_flag == 3 && loading_time > 20 && !jump)
-                dir = 4;
+            if (sc_flag == 3 && loading_time > 20)
+                pending_inputs.face = DIR_DOWN;
             break;
         case GLFW_KEY_A:
-            if (sc_flag == 3 && loading_time > 20 && !jump)
-                dir = 2;
+            if (sc_flag == 3 && loading_time > 20)
+                pending_inputs.face = DIR_LEFT;
             break;
         case GLFW_KEY_D:
-            if (sc_flag == 3 && loading_time > 20 && !jump)
-                dir = 3;
+            if (sc_flag == 3 && loading_time > 20)
+                pending_inputs.face = DIR_RIGHT;
             break;
         default:
             break;
@@ -566,16 +541,9 @@ void mouseButton(GLFWwindow* window, int button, int action, int mods)
                 if (hover_flag == 1)
                     sc_flag = 1;
                 if (hover_flag == 0) {
-                    lives = 3;
-                    level = 1;
-                    loading_time = 0;
-                    sc_flag = 3;
-                    px = 0;
-                    pz = 9;
-                    score = 0;
+                    newGame();
+                    startLoading();
                     pause = false;
-                    jump = false;
-                    dir = 1;
                 }
             }
             else if (sc_flag == 1) {
@@ -586,28 +554,24 @@ void mouseButton(GLFWwindow* window, int button, int action, int mods)
                 if (hover_flag == 6)
                     quit(window);
                 if (hover_flag == 5) {
-                    lives = 3;
-                    level = 1;
                     loading_time = 0;
                     sc_flag = 0;
                     hover_flag = 0;
                 }
             }
-	    else if(sc_flag == 3 && loading_time > 20 && !jump){
-		if(dir==1)
-			pz+=1;
-		else if(dir==4){
-			pz-=1;
-		}
-		else if(dir==2)
-			px-=1;
-		else if(dir==3)
-			px+=1;
+	    else if(sc_flag == 3 && loading_time > 20){
+		// The mouse steps against the facing direction along z
+		if(game.dir==DIR_UP)
+			pending_inputs.move = DIR_DOWN;
+		else if(game.dir==DIR_DOWN)
+			pending_inputs.move = DIR_UP;
+		else
+			pending_inputs.move = game.dir;
 	}
         break;
     case GLFW_MOUSE_BUTTON_RIGHT:
         if (action == GLFW_PRESS) {
-            jump=true;
+            pending_inputs.jump = true;
         }
         break;
     default:
@@ -622,7 +586,8 @@ void reshapeWindow(GLFWwindow* window, int width, int height)
     int fbwidth = width, fbheight = height;
     /* With Retina display on Mac OS X, GLFW's FramebufferSize
 	 is different from WindowSize */
-    glfwGetFramebufferSize(window, &fbwidth, &fbheight);
+    if (window)
+        glfwGetFramebufferSize(window, &fbwidth, &fbheight);
 
     GLfloat fov = 90.0f;
 
@@ -639,37 +604,16 @@ void reshapeWindow(GLFWwindow* window, int width, int height)
 
     // Ortho projection for 2D views
     Matrices.projection = glm::ortho(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 500.0f);
-}
+    camera.setProjection(Matrices.projection);
 
-VAO *cube[100], *rectangle, *hover, *dot, *loading_bar, *life[3], *player, *coins[5], *fire[5], *health_bar;
-int coins_x[5], coins_z[5];
-int fire_x[5], fire_z[5];
-
-// Creates the triangle object used in this sample code
-void createDot()
-{
-    static const GLfloat vertex_buffer_data[] = {
-        0.1, 0.1, 0,
-        0.1, -0.1, 0,
-        -0.1, -0.1, 0,
-
-        0.1, 0.1, 0,
-        -0.1, 0.1, 0,
-        -0.1, -0.1, 0
-    };
-    static const GLfloat color_buffer_data[] = {
-        0.5, 0.5, 0,
-        0.5, 0.5, 0,
-        0.5, 0.5, 0,
-
-        0.5, 0.5, 0,
-        0.5, 0.5, 0,
-        0.5, 0.5, 0,
-    };
-    dot = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
+    // Fixed camera for the 2D (ortho) screens and the HUD in XY plane
+    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 }
 
-void createFire(int n)
+VAO *tiles, *player, *coin, *fire;
+bool tile_instances_empty = true; // The tiles' instance buffer was just created and holds nothing yet
+
+void buildFire(MeshData& mesh)
 {
     static const GLfloat vertex_buffer_data[] = {
         1.0f, 0, 1.0f,
@@ -689,57 +633,12 @@ void createFire(int n)
         1, 0, 0,
         1, 0, 0
     };
-    int i;
-    for (i = 0; i < n; i++)
-        fire[i] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
+    buildColorMesh(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, mesh, GL_FILL);
 }
-void createLoadBar()
-{
-    static const GLfloat vertex_buffer_data[] = {
-        0.1, 0.1, 0,
-        0.1, -0.1, 0,
-        -0.1, -0.1, 0,
-
-        0.1, 0.1, 0,
-        -0.1, 0.1, 0,
-        -0.1, -0.1, 0
-    };
-    static const GLfloat color_buffer_data[] = {
-        0.7, 0.9, 0.7,
-        0.6, 0.8, 0.7,
-        0.7, 0.9, 0.7,
 
-        0.7, 0.9, 0.7,
-        0.6, 0.8, 0.7,
-        0.7, 0.9, 0.7,
-    };
-    loading_bar = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
-}
 
-void createHealthBar()
-{
-    static const GLfloat vertex_buffer_data[] = {
-        0.1, 0.1, 0,
-        0.1, -0.1, 0,
-        -0.1, -0.1, 0,
-
-        0.1, 0.1, 0,
-        -0.1, 0.1, 0,
-        -0.1, -0.1, 0
-    };
-    static const GLfloat color_buffer_data[] = {
-        1.0, 0, 0,
-        1.0, 0, 0,
-        1.0, 0, 0,
-
-        1.0, 0.0, 0.0,
-        1.0, 0.0, 0.0,
-        1.0, 0.0, 0.0,
-    };
-    health_bar = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
-}
-
-void createCube(int n)
+// Creates one cube mesh shared by all tiles of the board, drawn instanced
+void buildTiles(MeshData& mesh)
 {
     /* ONLY vertices between the bounds specified in glm::ortho will be visible on screen */
 
@@ -820,88 +719,87 @@ void createCube(int n)
 
     };
 
+    // One color per face, so the corners of a face share their vertices
     static const GLfloat color_buffer_data[] = {
 
         0.583f, 0.771f, 0.014f,
 
-        0.609f, 0.115f, 0.436f,
+        0.583f, 0.771f, 0.014f,
 
-        0.327f, 0.483f, 0.844f,
+        0.583f, 0.771f, 0.014f,
 
         0.822f, 0.569f, 0.201f,
 
-        0.435f, 0.602f, 0.223f,
+        0.822f, 0.569f, 0.201f,
 
-        0.310f, 0.747f, 0.185f,
+        0.822f, 0.569f, 0.201f,
 
         0.597f, 0.770f, 0.761f,
 
-        0.559f, 0.436f, 0.730f,
+        0.597f, 0.770f, 0.761f,
 
-        0.359f, 0.583f, 0.152f,
+        0.597f, 0.770f, 0.761f,
 
-        0.483f, 0.596f, 0.789f,
+        0.822f, 0.569f, 0.201f,
 
-        0.559f, 0.861f, 0.639f,
+        0.822f, 0.569f, 0.201f,
 
-        0.195f, 0.548f, 0.859f,
+        0.822f, 0.569f, 0.201f,
 
-        0.014f, 0.184f, 0.576f,
+        0.583f, 0.771f, 0.014f,
 
-        0.771f, 0.328f, 0.970f,
+        0.583f, 0.771f, 0.014f,
 
-        0.406f, 0.615f, 0.116f,
+        0.583f, 0.771f, 0.014f,
 
-        0.676f, 0.977f, 0.133f,
+        0.597f, 0.770f, 0.761f,
 
-        0.971f, 0.572f, 0.833f,
+        0.597f, 0.770f, 0.761f,
 
-        0.140f, 0.616f, 0.489f,
+        0.597f, 0.770f, 0.761f,
 
         0.997f, 0.513f, 0.064f,
 
-        0.945f, 0.719f, 0.592f,
+        0.997f, 0.513f, 0.064f,
 
-        0.543f, 0.021f, 0.978f,
+        0.997f, 0.513f, 0.064f,
 
         0.279f, 0.317f, 0.505f,
 
-        0.167f, 0.620f, 0.077f,
+        0.279f, 0.317f, 0.505f,
 
-        0.347f, 0.857f, 0.137f,
+        0.279f, 0.317f, 0.505f,
 
-        0.055f, 0.953f, 0.042f,
+        0.279f, 0.317f, 0.505f,
 
-        0.714f, 0.505f, 0.345f,
+        0.279f, 0.317f, 0.505f,
 
-        0.783f, 0.290f, 0.734f,
+        0.279f, 0.317f, 0.505f,
 
         0.722f, 0.645f, 0.174f,
 
-        0.302f, 0.455f, 0.848f,
+        0.722f, 0.645f, 0.174f,
 
-        0.225f, 0.587f, 0.040f,
+        0.722f, 0.645f, 0.174f,
 
-        0.517f, 0.713f, 0.338f,
+        0.722f, 0.645f, 0.174f,
 
-        0.053f, 0.959f, 0.120f,
+        0.722f, 0.645f, 0.174f,
 
-        0.393f, 0.621f, 0.362f,
+        0.722f, 0.645f, 0.174f,
 
-        0.673f, 0.211f, 0.457f,
+        0.997f, 0.513f, 0.064f,
 
-        0.820f, 0.883f, 0.371f,
+        0.997f, 0.513f, 0.064f,
 
-        0.982f, 0.099f, 0.879f
+        0.997f, 0.513f, 0.064f
 
     };
-    // create3DObject creates and returns a handle to a VAO that can be used later
-    int i;
-    for (i = 0; i < n; i++)
-        cube[i] = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
+    // buildColorMesh merges the vertices, the VAO is made from them later
+    buildColorMesh(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, mesh, GL_FILL);
 }
 
-void createCoins(int n)
+void buildCoins(MeshData& mesh)
 {
     /* ONLY vertices between the bounds specified in glm::ortho will be visible on screen */
 
@@ -1057,13 +955,11 @@ void createCoins(int n)
         1.f, 1.f, 0.f
 
     };
-    // create3DObject creates and returns a handle to a VAO that can be used later
-    int i;
-    for (i = 0; i < n; i++)
-        coins[i] = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
+    // buildColorMesh merges the vertices, the VAO is made from them later
+    buildColorMesh(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, mesh, GL_FILL);
 }
 
-void createPlayer()
+void buildPlayer(MeshData& mesh)
 {
     /* ONLY vertices between the bounds specified in glm::ortho will be visible on screen */
 
@@ -1219,115 +1115,7 @@ void createPlayer()
         0.5f, 0.f, 0.5f
 
     };
-    player = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
-}
-
-void createHover()
-{
-    /* ONLY vertices between the bounds specified in glm::ortho will be visible on screen */
-
-    /* Define vertex array as used in glBegin (GL_TRIANGLES) */
-    static const GLfloat vertex_buffer_data[] = {
-        -0.25, -0.25, 0, // vertex 1
-        0.25, -0.25, 0, // vertex 2
-        0.25, 0.25, 0, // vertex 3
-
-        0.25, 0.25, 0, // vertex 3
-        -0.25, 0.25, 0, // vertex 4
-        -0.25, -0.25, 0 // vertex 1
-    };
-
-    static const GLfloat color_buffer_data[] = {
-        1, 1, 0, // color 1
-        1, 1, 0, // color 2
-        1, 1, 0, // color 3
-
-        1, 1, 0, // color 3
-        1, 1, 0, // color 4
-        1, 1, 0 // color 1
-    };
-
-    // create3DObject creates and returns a handle to a VAO that can be used later
-    hover = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
-}
-
-// Creates the rectangle object used in this sample code
-void createRectangle(GLuint textureID)
-{
-    // GL3 accepts only Triangles. Quads are not supported
-    static const GLfloat vertex_buffer_data[] = {
-        -4, -4, 0, // vertex 1
-        4, -4, 0, // vertex 2
-        4, 4, 0, // vertex 3
-
-        4, 4, 0, // vertex 3
-        -4, 4, 0, // vertex 4
-        -4, -4, 0 // vertex 1
-    };
-
-    static const GLfloat color_buffer_data[] = {
-        1, 0, 0, // color 1
-        0, 0, 1, // color 2
-        0, 1, 0, // color 3
-
-        0, 1, 0, // color 3
-        0.3, 0.3, 0.3, // color 4
-        1, 0, 0 // color 1
-    };
-
-    // Texture coordinates start with (0,0) at top left of the image to (1,1) at bot right
-    static const GLfloat texture_buffer_data[] = {
-        0, 1, // TexCoord 1 - bot left
-        1, 1, // TexCoord 2 - bot right
-        1, 0, // TexCoord 3 - top right
-
-        1, 0, // TexCoord 3 - top right
-        0, 0, // TexCoord 4 - top left
-        0, 1 // TexCoord 1 - bot left
-    };
-
-    // create3DTexturedObject creates and returns a handle to a VAO that can be used later
-    rectangle = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data, texture_buffer_data, textureID, GL_FILL);
-}
-
-void createLives(GLuint textureID)
-{
-    // GL3 accepts only Triangles. Quads are not supported
-    static const GLfloat vertex_buffer_data[] = {
-        -4, -4, 0, // vertex 1
-        4, -4, 0, // vertex 2
-        4, 4, 0, // vertex 3
-
-        4, 4, 0, // vertex 3
-        -4, 4, 0, // vertex 4
-        -4, -4, 0 // vertex 1
-    };
-
-    static const GLfloat color_buffer_data[] = {
-        1, 0, 0, // color 1
-        0, 0, 1, // color 2
-        0, 1, 0, // color 3
-
-        0, 1, 0, // color 3
-        0.3, 0.3, 0.3, // color 4
-        1, 0, 0 // color 1
-    };
-
-    // Texture coordinates start with (0,0) at top left of the image to (1,1) at bot right
-    static const GLfloat texture_buffer_data[] = {
-        0, 1, // TexCoord 1 - bot left
-        1, 1, // TexCoord 2 - bot right
-        1, 0, // TexCoord 3 - top right
-
-        1, 0, // TexCoord 3 - top right
-        0, 0, // TexCoord 4 - top left
-        0, 1 // TexCoord 1 - bot left
-    };
-
-    // create3DTexturedObject creates and returns a handle to a VAO that can be used later
-    int i;
-    for (i = 0; i < 3; i++)
-        life[i] = create3DTexturedObject(GL_TRIANGLES, 6, vertex_buffer_data, texture_buffer_data, textureID, GL_FILL);
+    buildColorMesh(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, mesh, GL_FILL);
 }
 
 /* Render the scene with openGL */
@@ -1337,10 +1125,6 @@ void startscreen()
     // clear the color and depth in the frame buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // use the loaded shader program
-    // Don't change unless you know what you are doing
-    glUseProgram(programID);
-
     static float c = 0;
     c++;
     //Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(sinf(c*M_PI/180.0),3*cosf(c*M_PI/180.0),0)); // Fixed camera for 2D (ortho) in XY plane
@@ -1349,120 +1133,30 @@ void startscreen()
     //  Don't change unless you are sure!!
     glm::mat4 VP = Matrices.projection * Matrices.view;
 
-    // Send our transformation to the currently bound shader, in the "MVP" uniform
-    // For each model you render, since the MVP will be different (at least the M part)
-    //  Don't change unless you are sure!!
-    glm::mat4 MVP; // MVP = Projection * View * Model
-
-    // Render with texture shaders now
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
-    Matrices.model = glm::mat4(1.0f);
-
-    //glm::mat4 translateRectangle = glm::translate (glm::vec3(2, 0, 0));        // glTranslatef
-    //glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-    //Matrices.model *= (translateRectangle * rotateRectangle);
-    MVP = VP * Matrices.model;
-
-    // Copy MVP to texture shaders
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // Set the texture sampler to access Texture0 memory
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DTexturedObject(rectangle);
-
     if (hover_flag == 0)
         hover_y = 0;
     else if (hover_flag == 1)
         hover_y = -1;
     else if (hover_flag == 2)
         hover_y = -2;
-    // Load identity to model matrix
-    Matrices.model = glm::mat4(1.0f);
-
-    /* Render your scene */
-    glm::mat4 translateHover = glm::translate(glm::vec3(-0.1f, 0.15f + hover_y, 0.0f)); // glTranslatef
-    glm::mat4 scaleHover = glm::scale(glm::vec3(4.f, 1.f, 0.f));
-    //glm::mat4 HoverTransform = translateTriangle * rotateTriangle;
-    Matrices.model *= (translateHover * scaleHover);
-    MVP = VP * Matrices.model; // MVP = p * V * M
-
-    //  Don't change unless you are sure!!
-    // Copy MVP to normal shaders
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DObject(hover);
-
-    // Increment angles
-    float increments = 1;
-
-    // Render font on screen
-    glm::vec3 fontColor = getRGBfromHue(0);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateTitle = glm::translate(glm::vec3(-2, 2, 0));
-    Matrices.model *= translateTitle;
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-
-    // Render font
-    GL3Font.font->Render("G r a v i t y");
-
-    glm::vec3 fontColor1 = getRGBfromHue(100);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
 
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateNewGame = glm::translate(glm::vec3(-1, 0, 0));
-    glm::mat4 scaleNewGame = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateNewGame * scaleNewGame);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor1[0]);
-    // Render font
-    GL3Font.font->Render("New Game");
-
-    glm::vec3 fontColor2 = getRGBfromHue(50);
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateControls = glm::translate(glm::vec3(-1, -1, 0));
-    glm::mat4 scaleControls = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateControls * scaleControls);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor2[0]);
-    // Render font
-    GL3Font.font->Render("Controls");
-
-    glm::vec3 fontColor3 = getRGBfromHue(200);
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateQuit = glm::translate(glm::vec3(-1, -2, 0));
-    glm::mat4 scaleQuit = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateQuit * scaleQuit);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Quit");
+    // The background and the highlight over it, laid out once; afterwards
+    // only the highlight moves
+    if (startSprites.empty()) {
+        startSprites.add("space1.jpg", 0, 0, 8, 8);
+        startHoverSlot = startSprites.add("solid", -0.1f, 0.15f, 2, 0.5f, glm::vec3(1, 1, 0));
+    }
+    startSprites.place(startHoverSlot, -0.1f, 0.15f + hover_y, 2, 0.5f);
+    submitSprites(LAYER_BACKGROUND, startSprites, VP);
+
+    // Lay out the menu text once
+    if (startText.empty()) {
+        startText.add("G r a v i t y", -2, 2, 1, getRGBfromHue(0));
+        startText.add("New Game", -1, 0, 0.75, getRGBfromHue(100));
+        startText.add("Controls", -1, -1, 0.75, getRGBfromHue(50));
+        startText.add("Quit", -1, -2, 0.75, getRGBfromHue(200));
+    }
+    submitText(startText, VP);
 }
 
 void controlsscreen()
@@ -1471,10 +1165,6 @@ void controlsscreen()
     // clear the color and depth in the frame buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // use the loaded shader program
-    // Don't change unless you know what you are doing
-    glUseProgram(programID);
-
     static float c = 0;
     c++;
     //Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(sinf(c*M_PI/180.0),3*cosf(c*M_PI/180.0),0)); // Fixed camera for 2D (ortho) in XY plane
@@ -1483,126 +1173,29 @@ void controlsscreen()
     //  Don't change unless you are sure!!
     glm::mat4 VP = Matrices.projection * Matrices.view;
 
-    // Send our transformation to the currently bound shader, in the "MVP" uniform
-    // For each model you render, since the MVP will be different (at least the M part)
-    //  Don't change unless you are sure!!
-    glm::mat4 MVP; // MVP = Projection * View * Model
-
-    // Render with texture shaders now
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
-    Matrices.model = glm::mat4(1.0f);
-
-    //glm::mat4 translateRectangle = glm::translate (glm::vec3(2, 0, 0));        // glTranslatef
-    //glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-    //Matrices.model *= (translateRectangle * rotateRectangle);
-    MVP = VP * Matrices.model;
-
-    // Copy MVP to texture shaders
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // Set the texture sampler to access Texture0 memory
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DTexturedObject(rectangle);
-
-    Matrices.model = glm::mat4(1.0f);
-
-    /* Render your scene */
-    glm::mat4 translateHover = glm::translate(glm::vec3(-3.4f, 3.6f, 0.0f)); // glTranslatef
-    glm::mat4 scaleHover = glm::scale(glm::vec3(1.5f, 0.75f, 0.f));
-    //glm::mat4 HoverTransform = translateTriangle * rotateTriangle;
-    Matrices.model *= (translateHover * scaleHover);
-    MVP = VP * Matrices.model; // MVP = p * V * M
-
-    //  Don't change unless you are sure!!
-    // Copy MVP to normal shaders
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    if (hover_flag == 4)
-        draw3DObject(hover);
-
-    // Increment angles
-    float increments = 1;
-
-    // Render font on screen
-    glm::vec3 fontColor = getRGBfromHue(0);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateTitle = glm::translate(glm::vec3(-1.5, 3, 0));
-    Matrices.model *= translateTitle;
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-
-    // Render font
-    GL3Font.font->Render("CONTROLS");
-
-    glm::vec3 fontColor1 = getRGBfromHue(100);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateNewGame = glm::translate(glm::vec3(-3.5, 2, 0));
-    glm::mat4 scaleNewGame = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateNewGame * scaleNewGame);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor1[0]);
-    // Render font
-    GL3Font.font->Render("Keyboard");
-
-    glm::vec3 fontColor2 = getRGBfromHue(50);
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateControls = glm::translate(glm::vec3(2.5, 2, 0));
-    glm::mat4 scaleControls = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateControls * scaleControls);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor2[0]);
-    // Render font
-    GL3Font.font->Render("Mouse");
-
-    glm::vec3 fontColor3 = getRGBfromHue(200);
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateQuit = glm::translate(glm::vec3(-3.75, 3.5, 0));
-    glm::mat4 scaleQuit = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateQuit * scaleQuit);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Back");
+    // The background, and the highlight over "Back" while the mouse is on it
+    if (controlsSprites.empty()) {
+        controlsSprites.add("space2.jpg", 0, 0, 8, 8);
+        controlsHoverSlot = controlsSprites.add("solid", -3.4f, 3.6f, 0.75f, 0.375f, glm::vec3(1, 1, 0));
+    }
+    controlsSprites.show(controlsHoverSlot, hover_flag == 4);
+    submitSprites(LAYER_BACKGROUND, controlsSprites, VP);
+
+    // Lay out the controls text once
+    if (controlsText.empty()) {
+        controlsText.add("CONTROLS", -1.5, 3, 1, getRGBfromHue(0));
+        controlsText.add("Keyboard", -3.5, 2, 0.75, getRGBfromHue(100));
+        controlsText.add("Mouse", 2.5, 2, 0.75, getRGBfromHue(50));
+        controlsText.add("Back", -3.75, 3.5, 0.5, getRGBfromHue(200));
+    }
+    submitText(controlsText, VP);
 }
 
 void loading_effect()
 {
-
     // clear the color and depth in the frame buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // use the loaded shader program
-    // Don't change unless you know what you are doing
-    glUseProgram(programID);
-
     static float c = 0;
     c++;
     //Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(sinf(c*M_PI/180.0),3*cosf(c*M_PI/180.0),0)); // Fixed camera for 2D (ortho) in XY plane
@@ -1611,36 +1204,10 @@ void loading_effect()
     //  Don't change unless you are sure!!
     glm::mat4 VP = Matrices.projection * Matrices.view;
 
-    // Send our transformation to the currently bound shader, in the "MVP" uniform
-    // For each model you render, since the MVP will be different (at least the M part)
-    //  Don't change unless you are sure!!
-    glm::mat4 MVP; // MVP = Projection * View * Model
-
-    // Render with texture shaders now
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
-    Matrices.model = glm::mat4(1.0f);
-
-    //glm::mat4 translateRectangle = glm::translate (glm::vec3(2, 0, 0));        // glTranslatef
-    //glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-    //Matrices.model *= (translateRectangle * rotateRectangle);
-    MVP = VP * Matrices.model;
-
-    // Copy MVP to texture shaders
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // Set the texture sampler to access Texture0 memory
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DTexturedObject(rectangle);
-
     float scx = 1.3;
     float check_float_x;
     int check_int_x;
-    check_float_x = loading_time / 0.6;
+    check_float_x = loading_clock / 0.6;
     check_int_x = check_float_x;
     check_float_x = check_float_x - check_int_x;
     if (check_float_x >= 0 && check_float_x <= 0.17)
@@ -1649,57 +1216,128 @@ void loading_effect()
         scx = 1.55;
     else if (check_float_x > 0.6 && check_float_x < 0.9)
         scx = 1.8;
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateDot = glm::translate(glm::vec3(scx, -0.12, 0)); // glTranslatef
-    Matrices.model *= (translateDot);
-    MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    draw3DObject(dot);
-    glUseProgram(programID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLoadBar = glm::translate(glm::vec3(-2.96 + loading_time * 0.15, -2.48, 0)); // glTranslatef
-    Matrices.model *= (translateLoadBar);
-    glm::mat4 scaleLoadBar = glm::scale(glm::vec3(1 + (loading_time * 1.5), 2.5, 1));
-    Matrices.model *= (scaleLoadBar);
-    MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    draw3DObject(loading_bar);
+
+    // The background, the moving dot and the bar, which grows with the loader
+    if (loadingSprites.empty()) {
+        loadingSprites.add("loading.jpg", 0, 0, 8, 8);
+        dotSlot = loadingSprites.add("solid", scx, -0.12f, 0.2f, 0.2f, glm::vec3(0.5f, 0.5f, 0));
+        loadingBarSlot = loadingSprites.add("solid", -2.96f, -2.48f, 0.2f, 0.5f, glm::vec3(0.7f, 0.9f, 0.7f));
+    }
+    loadingSprites.place(dotSlot, scx, -0.12f, 0.2f, 0.2f);
+    loadingSprites.place(loadingBarSlot, -2.96f + loading_time * 0.15f, -2.48f, 0.2f * (1 + loading_time * 1.5f), 0.5f);
+    submitSprites(LAYER_BACKGROUND, loadingSprites, VP);
 }
-float ttime = 0;
-void gamescreen()
+/* Copy the simulation values the renderer interpolates */
+SimSnapshot captureSim()
+{
+    SimSnapshot snapshot;
+    snapshot.cy = game.cy;
+    snapshot.rx = game.rx;
+    snapshot.ry = game.ry;
+    snapshot.camera_rotation_angle = camera_rotation_angle;
+    snapshot.px = game.px;
+    snapshot.pz = game.pz;
+    snapshot.jump = game.jump;
+    return snapshot;
+}
+
+/* Blend the last two simulation steps for drawing */
+/* Discrete changes (steps, landings, respawns) are not blended, they snap */
+SimSnapshot interpolatedSim()
 {
+    if (previous_sim.px != current_sim.px || previous_sim.pz != current_sim.pz || previous_sim.jump != current_sim.jump)
+        return current_sim;
+
+    SimSnapshot view = current_sim;
+    view.cy = glm::mix(previous_sim.cy, current_sim.cy, sim_alpha);
+    view.rx = glm::mix(previous_sim.rx, current_sim.rx, sim_alpha);
+    view.ry = glm::mix(previous_sim.ry, current_sim.ry, sim_alpha);
+    view.camera_rotation_angle = glm::mix(previous_sim.camera_rotation_angle, current_sim.camera_rotation_angle, sim_alpha);
+    return view;
+}
+
+/* Advance everything that moves by one step of SIM_DT, whatever the screen */
+void simulationStep()
+{
+    if (sc_flag == 3) {
+        if (loading_time >= 0 && loading_time <= 20) {
+            // The bar follows the loader and the game starts once it is done
+            loading_clock += 0.1;
+            loading_time = assetLoader.idle() ? 21 : 20 * assetLoader.progress();
+        }
+        else {
+            GameInputs inputs = pending_inputs;
+            if (replaying && !replay_log.next(inputs))
+                inputs = GameInputs(); // The log ended before the game did
+            step(game, inputs, SIM_DT);
+            if (recorder.isOpen())
+                recorder.record(inputs);
+            if (game.over && bench_seconds > 0)
+                newGame(); // The benchmark outlasts the level timer
+            else if (game.over) {
+                recorder.close(game);
+                sc_flag = 4;
+                hover_flag = 5;
+                tower_view = false;
+                top_view = false;
+                adventure_view = false;
+                follow_view = false;
+            }
+        }
+    }
+    pending_inputs = GameInputs();
+
+    if (helicopter_view) {
+        if (turn == 1)
+            camera_rotation_angle -= 0.5;
+        else if (turn == -1)
+            camera_rotation_angle += 0.5;
+    }
+}
 
-    if(c_i!=0){
-	if(dir==1)
-		pz-=1;
-	else if(dir==4)
-		pz+=1;
-	else if(dir==2)
-		px-=1;
-	else if(dir==3)
-		px+=1;
-	c_i--;
+/* The profiler's averages as a table in the top left corner, in ms per frame */
+void submitProfile(const glm::mat4& VP)
+{
+    if (profileText.empty()) {
+        glm::vec3 color = getRGBfromHue(60);
+        float y = 2.9f;
+        profileText.add("phase", -3.9f, y, 0.25f, color);
+        profileText.add("cpu", -2.3f, y, 0.25f, color);
+        profileText.add("gpu", -1.5f, y, 0.25f, color);
+        for (int p = 0; p <= PROFILE_PHASES; p++) {
+            y -= 0.3f;
+            profileText.add(p < PROFILE_PHASES ? Profiler::name((ProfilePhase)p) : "frame", -3.9f, y, 0.25f, color);
+            profileSlots[p][0] = profileText.add("", -2.3f, y, 0.25f, color);
+            profileSlots[p][1] = profileText.add("", -1.5f, y, 0.25f, color);
+        }
     }
-    if(helicopter_view){
-    	if(turn==1)
-		camera_rotation_angle-=0.5;
-    	else if(turn==-1)
-		camera_rotation_angle+=0.5;
+    char value[16];
+    for (int p = 0; p < PROFILE_PHASES; p++) {
+        snprintf(value, sizeof(value), "%.2f", profiler.cpu((ProfilePhase)p));
+        profileText.set(profileSlots[p][0], value);
+        snprintf(value, sizeof(value), "%.2f", profiler.gpu((ProfilePhase)p));
+        profileText.set(profileSlots[p][1], value);
     }
+    snprintf(value, sizeof(value), "%.2f", profiler.frameCpu());
+    profileText.set(profileSlots[PROFILE_PHASES][0], value);
+    submitText(profileText, VP);
+}
+
+void gamescreen()
+{
+    // Normally built behind the loading screen, which --bench skips
+    createGameResources();
+    SimSnapshot view = interpolatedSim();
+
     // clear the color and depth in the frame buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // use the loaded shader program
-    // Don't change unless you know what you are doing
-    glUseProgram(programID);
-
     static float c = 0;
     c++;
     //Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(sinf(c*M_PI/180.0),3*cosf(c*M_PI/180.0),0)); // Fixed camera for 2D (ortho) in XY plane
 
     // Compute ViewProject matrix as view/camera might not be changed for this frame (basic scenario)
     //  Don't change unless you are sure!!
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
     glm::mat4 VP = Matrices.projection * Matrices.view;
 
     // Send our transformation to the currently bound shader, in the "MVP" uniform
@@ -1707,59 +1345,30 @@ void gamescreen()
     //  Don't change unless you are sure!!
     glm::mat4 MVP; // MVP = Projection * View * Model
 
-    // Render with texture shaders now
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
-
     Matrices.model = glm::mat4(1.0f);
-
-    //glm::mat4 translateRectangle = glm::translate (glm::vec3(2, 0, 0));        // glTranslatef
-    //glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-    //Matrices.model *= (translateRectangle * rotateRectangle);
     MVP = VP * Matrices.model;
 
-    // Copy MVP to texture shaders
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // Set the texture sampler to access Texture0 memory
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    //	if(!pause)
-    //		draw3DTexturedObject(rectangle);
-
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
+    // The lives icons and the status bars, one sprite draw; the health bar
+    // comes last so it covers the bar behind it
+    ProfileScope bars_scope(PROFILE_STATUS_BARS);
     int i = 0;
-    for (i = 0; i < lives; i++) {
-        Matrices.model = glm::mat4(1.0f);
-
-        glm::mat4 translateLife = glm::translate(glm::vec3(-2.4 + 0.4 * i, 3.6, 0));
-        glm::mat4 scaleLife = glm::scale(glm::vec3(0.05, 0.05, 0.05));
-        Matrices.model *= (translateLife * scaleLife);
-        MVP = VP * Matrices.model;
-
-        // Copy MVP to texture shaders
-        glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-        // Set the texture sampler to access Texture0 memory
-        glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-        // draw3DObject draws the VAO given to it using current MVP matrix
-        draw3DTexturedObject(life[i]);
+    if (hudSprites.empty()) {
+        for (i = 0; i < 3; i++)
+            lifeSlots[i] = hudSprites.add("lives.jpg", -2.4f + 0.4f * i, 3.6f, 0.4f, 0.4f);
+        hudSprites.add("solid", 3.5f, -1.96f + 15 * 0.15f, 0.24f, 0.2f * (1 + 15 * 1.5f), glm::vec3(0.7f, 0.9f, 0.7f));
+        healthBarSlot = hudSprites.add("solid", 3.5f, -1.96f, 0.2f, 0.2f, glm::vec3(1, 0, 0));
     }
+    for (i = 0; i < 3; i++)
+        hudSprites.show(lifeSlots[i], i < game.lives);
+    hudSprites.place(healthBarSlot, 3.5f, -1.96f + game.health * 0.15f, 0.2f, 0.2f * (1 + game.health * 1.5f));
+    submitSprites(LAYER_HUD, hudSprites, VP);
+    bars_scope.stop();
     // Increment angles
     float increments = 1;
 
-    // Render font on screen
-    glm::vec3 fontColor = getRGBfromHue(0);
-
-    if (temp_score != score || score == 0) {
-        temp_score = score;
+    ProfileScope text_scope(PROFILE_HUD_TEXT);
+    if (temp_score != game.score || game.score == 0) {
+        temp_score = game.score;
         int i, r, length = 0;
         for (i = 0; i < 3; i++) {
             r = temp_score % 10;
@@ -1771,7 +1380,7 @@ void gamescreen()
         for (i = 0; i < 3; i++)
             if (score_string[i] == '0' && i >= length)
                 score_string[i] = ' ';
-        if (score == 0) {
+        if (game.score == 0) {
             score_string[0] = '0';
         }
         char c;
@@ -1780,394 +1389,151 @@ void gamescreen()
             score_string[i] = score_string[length - 1 - i];
             score_string[length - 1 - i] = c;
         }
-        temp_score = score;
+        temp_score = game.score;
     }
-    time_c=timer;
+    time_c=game.timer;
     int r;
     for(i=0;i<2;i++){
 	r=time_c%10;
 	time_c/=10;
 	time_string[1-i]= (char)(r + 48);
 	}
-    glm::vec3 fontColor3 = getRGBfromHue(200);
-
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateScore_text = glm::translate(glm::vec3(2, 3.5, 0));
-    glm::mat4 scaleScore_text = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateScore_text * scaleScore_text);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Score :");
-
-    // Transform the text
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateScore = glm::translate(glm::vec3(3.5, 3.5, 0));
-    glm::mat4 scaleScore = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateScore * scaleScore);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render(score_string);
-
-    // Transform the text
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLevel_text = glm::translate(glm::vec3(-0.75, 3.5, 0));
-    glm::mat4 scaleLevel_text = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateLevel_text * scaleLevel_text);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Level :");
-
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLevel = glm::translate(glm::vec3(0.75, 3.5, 0));
-    glm::mat4 scaleLevel = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateLevel * scaleLevel);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    level_string[0] = (char)(level + 48);
-    GL3Font.font->Render(level_string);
-
-    // Transform the text
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLives_text = glm::translate(glm::vec3(-3.75, 3.5, 0));
-    glm::mat4 scaleLives_text = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateLives_text * scaleLives_text);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Lives :");
-
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLives = glm::translate(glm::vec3(-2.25, 3.5, 0));
-    glm::mat4 scaleLives = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateLives * scaleLives);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    //lives_string[0]=(char)(lives+48);
-    GL3Font.font->Render(lives_string);
-
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateTime_text = glm::translate(glm::vec3(2, -3.5, 0));
-    glm::mat4 scaleTime_text = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateTime_text * scaleTime_text);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Timer :");
-
-    glUseProgram(fontProgramID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateTime = glm::translate(glm::vec3(3.25, -3.5, 0));
-    glm::mat4 scaleTime = glm::scale(glm::vec3(0.5, 0.5, 1));
-    Matrices.model *= (translateTime * scaleTime);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    //lives_string[0]=(char)(lives+48);
-    GL3Font.font->Render(time_string,2);
-
-    glUseProgram(programID);
-
-    glUseProgram(programID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateLoadBar = glm::translate(glm::vec3(3.5, -1.96 + 15 * 0.15, 0)); // glTranslatef
-    Matrices.model *= (translateLoadBar);
-    glm::mat4 scaleLoadBar = glm::scale(glm::vec3(1.2, 1 + (15 * 1.5), 1));
-    Matrices.model *= (scaleLoadBar);
-    MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    draw3DObject(loading_bar);
-
-    glUseProgram(programID);
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateHealthBar = glm::translate(glm::vec3(3.5, -1.96 + health * 0.15, 0)); // glTranslatef
-    Matrices.model *= (translateHealthBar);
-    glm::mat4 scaleHealthBar = glm::scale(glm::vec3(1, 1 + (health * 1.5), 1));
-    Matrices.model *= (scaleHealthBar);
-    MVP = VP * Matrices.model;
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    draw3DObject(health_bar);
-
-    int cx = 0, cz = 0;
-    for (i = 0; i < 100; i++) {
-        Matrices.model = glm::mat4(1.0f);
-        /* Render your scene */
-        if (i == 97 && level==3) {
-            if (cy >= 0.5) {
-                b_m = 1;
-            }
-            if (cy <= -0.5) {
-                b_m = 0;
-            }
-            if (b_m == 0) {
-                cy += 0.01;
-            }
-            else if (b_m == 1) {
-                cy -= 0.01;
-            }
-	}
-        glm::mat4 translateCube;
-        if (i == tile[0] || i == tile[1] || i == tile[2] || i == tile[3] || i == tile[4])
-            translateCube = glm::translate(glm::vec3(-3 + 0.6f * cx, 0.f + cy, 0.6f * cz)); // glTranslatef
-        else
-            translateCube = glm::translate(glm::vec3(-3 + 0.6f * cx, 0.f, 0.6f * cz)); // glTranslatef
-        glm::mat4 scaleCube = glm::scale(glm::vec3(0.3f, 0.3f, 0.3f));
-        //glm::mat4 HoverTransform = translateTriangle * rotateTriangle;
-        Matrices.model *= (translateCube * scaleCube);
-        GLfloat ex,ey,ez,tx,ty,tz,ux,uy,uz;
-        ex =  0.5;
-	ey = 2;
-        ez = 7;
-	tx=0;
-	ty=0;
-	tz=0;
-	ux=0;
-	uy=1;
-	uz=0;
-	if(tower_view){
-		//fprintf(stderr,"In\n");
-		ex = 0;
-		ey = 10;
-        	ez = 10;
-		tx=0;
-		ty=0;
-		tz=0;
-		ux=0;
-		uy=1;
-		uz=0;
-	}
-	else if(top_view){
-		ex = 0;
-		ey = 10;
-        	ez = 0;
-		tx=0;
-		ty=0;
-		tz=3;
-		ux=0;
-		uy=-1;
-		uz=0;
-	}
-	else if(follow_view){
-		ex =  0.6f * px -3;
-		ey = 5;
-        	ez = 7+(0.6*pz);
-		tx=-3 + 0.6f * px;
-		ty=0.5f + ry + cy;
-		tz=0.6f * pz;
-		ux=0;
-		uy=1;
-		uz=0;
-	}
-	else if(helicopter_view){
-		ex = sin(camera_rotation_angle * M_PI / 180.0f) * 10;
-		ey = 2;
-        	ez = cos(camera_rotation_angle * M_PI / 180.0f) * 10;
-		tx=0;
-		ty=0;
-		tz=0;
-		ux=0;
-		uy=1;
-		uz=0;
-	}
-	else if(adventure_view){
-		ex = -3 + 0.6f * px;
-		ey = 0.5 + ry + cy+1;
-        	ez = 0.6*pz-2;
-		tx= -3 + 0.6f * px;
-		ty= 0.5f + ry + cy;
-		tz= 0.6f * pz-2;
-		if(dir==1)
-			tz= 0.6f * pz - 5;
-		else if(dir==4)
-			tz= 0.6f * pz + 5;
-		else if(dir==2)
-			tx= -3 + 0.6f * px - 5;
-		else if(dir==3)
-			tx= -3 + 0.6f * px + 5;
-		ux=0;
-		uy=1;
-		uz=0;
-		
-	}
-        Matrices.view = glm::lookAt(glm::vec3(ex, ey, ez), glm::vec3(tx, ty, tz), glm::vec3(ux, uy, uz)); // Fixed camera for 2D (ortho) in XY plane
-        VP = Matrices.projection * Matrices.view;
-        MVP = VP * Matrices.model; // MVP = p * V * M
-        //  Don't change unless you are sure!!
-        // Copy MVP to normal shaders
-        glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-        if (i == hole[0] || i == hole[1] || i == hole[2] || i == hole[3] || i == hole[4])
-            ;
-        else
-            draw3DObject(cube[i]);
-        cx++;
-        if (cx > 9) {
-            cx = 0;
-            cz++;
-        }
+    // Lay out the HUD once, afterwards only the values are updated
+    if (hudText.empty()) {
+        glm::vec3 fontColor3 = getRGBfromHue(200);
+        hudText.add("Score :", 2, 3.5, 0.5, fontColor3);
+        scoreSlot = hudText.add("", 3.5, 3.5, 0.5, fontColor3);
+        hudText.add("Level :", -0.75, 3.5, 0.5, fontColor3);
+        levelSlot = hudText.add("", 0.75, 3.5, 0.5, fontColor3);
+        hudText.add("Lives :", -3.75, 3.5, 0.5, fontColor3);
+        livesSlot = hudText.add("", -2.25, 3.5, 0.5, fontColor3);
+        hudText.add("Timer :", 2, -3.5, 0.5, fontColor3);
+        timeSlot = hudText.add("", 3.25, -3.5, 0.5, fontColor3);
     }
-    if (jump) {
-        rx = (0.6 * ttime);
-        ry = (0.4 * ttime) - (0.2 * ttime * ttime);
-        ttime += 0.1;
-        if (ttime > 2.1) {
-            jump = false;
-            if (dir == 1)
-                pz -= 2;
-            else if (dir == 4)
-                pz += 2;
-            else if (dir == 2)
-                px -= 2;
-            else if (dir == 3)
-                px += 2;
-            rx = 0;
-            ttime = 0;
-        }
+    level_string[0] = (char)(game.level + 48);
+    //lives_string[0]=(char)(game.lives+48);
+    hudText.set(scoreSlot, score_string, 3);
+    hudText.set(levelSlot, level_string, 1);
+    hudText.set(livesSlot, lives_string, 1);
+    hudText.set(timeSlot, time_string, 2);
+    submitText(hudText, VP);
+    text_scope.stop();
+
+    // Build the view once for the whole frame, every world draw below shares it
+    CameraTarget camera_target;
+    camera_target.player = glm::vec3(boardX(view.px), 0.5f + view.ry + view.cy, boardZ(view.pz));
+    camera_target.dir = game.dir;
+    camera_target.orbitAngle = view.camera_rotation_angle;
+    camera.setMode(activeCameraMode());
+    camera.update(camera_target, frame_time);
+    VP = camera.viewProjection();
+
+    ProfileScope tiles_scope(PROFILE_TILES);
+    // The loader built the tiles of a new game, only changes are left here
+    const Board& board = game.board;
+    updateTileInstances(board, board_tiles);
+    // A new board size, or a new game's tiles VAO, needs a fresh instance
+    // buffer, which holds nothing until the stream below fills it
+    static int instance_cells = -1;
+    bool new_buffer = tile_instances_empty || instance_cells != board.cells();
+    if (new_buffer) {
+        addInstanceBuffer(tiles, board.cells());
+        instance_cells = board.cells();
+        tile_instances_empty = false;
+    }
+
+    // Only the chunks whose bounds touch the frustum are streamed to the GPU;
+    // the stream is rebuilt when the set of visible chunks or their tiles change
+    Frustum frustum = camera.frustum();
+    static std::vector<int> visible_chunks, streamed_chunks;
+    static std::vector<GLfloat> tile_stream;
+    visible_chunks.clear();
+    for (int chunk = 0; chunk < board.chunkCount(); chunk++) {
+        int x0 = board.cellX(chunk * Board::CHUNK_CELLS), z0 = board.cellZ(chunk * Board::CHUNK_CELLS);
+        int x1 = min(x0 + Board::CHUNK_SIZE, board.width()) - 1, z1 = min(z0 + Board::CHUNK_SIZE, board.height()) - 1;
+        // Tiles are cubes of half size 0.3, moving ones travel 0.5 up or down
+        float lift = board.chunkBits(chunk, CELL_MOVING) ? 0.5f : 0;
+        glm::vec3 lo(boardX(x0) - 0.3f, -0.3f - lift, boardZ(z0) - 0.3f);
+        glm::vec3 hi(boardX(x1) + 0.3f, 0.3f + lift, boardZ(z1) + 0.3f);
+        if (frustum.intersects(lo, hi))
+            visible_chunks.push_back(chunk);
     }
-    if (px < 0 || px > 9 || pz > 9 || pz < 0 || (hole[0] == (pz * 10 + px)) || (hole[1] == (pz * 10 + px)) || (hole[2] == (pz * 10 + px)) || (hole[3] == (pz * 10 + px)) || (hole[4] == (pz * 10 + px)) || health <= 0) {
-        lives--;
-        px = 0;
-        pz = 9;
-        health = 15;
+    tile_culling.chunksTested = board.chunkCount();
+    tile_culling.chunksDrawn = (int)visible_chunks.size();
+    if (new_buffer || board_tiles.fresh || visible_chunks != streamed_chunks) {
+        tile_stream.resize(visible_chunks.size() * 4 * Board::CHUNK_CELLS);
+        for (size_t k = 0; k < visible_chunks.size(); k++)
+            memcpy(&tile_stream[k * 4 * Board::CHUNK_CELLS], &board_tiles.data[visible_chunks[k] * 4 * Board::CHUNK_CELLS], 4 * Board::CHUNK_CELLS * sizeof(GLfloat));
+        if (!visible_chunks.empty())
+            streamInstanceBuffer(tiles, &tile_stream[0], (int)visible_chunks.size() * Board::CHUNK_CELLS);
+        streamed_chunks = visible_chunks;
+        board_tiles.fresh = false;
     }
-	
-    for (i = 0; i < 5; i++) {
+
+    // Draw the visible part of the board with one instanced call
+    if (!visible_chunks.empty())
+        renderQueue.submit(DrawItem::instanced(LAYER_BOARD, tileProgram->id(), tileProgram->location(UNIFORM_VP), tiles, VP)
+                               .uniform(tileProgram->location(UNIFORM_TILE_SCALE), 0.3f)
+                               .uniform(tileProgram->location(UNIFORM_TILE_LIFT), view.cy));
+    tiles_scope.stop();
+
+    ProfileScope obstacles_scope(PROFILE_OBSTACLES);
+    for (i = 0; i < (int)game.coins.size(); i++) {
+        int cell = game.coins[i];
+        if (cell < 0)
+            continue;
         Matrices.model = glm::mat4(1.0f);
         /* Render your scene */
-        glm::mat4 translateCoins = glm::translate(glm::vec3(-3 + 0.6f * coins_x[i], 0.5f, 0.6f * coins_z[i])); // glTranslatef
+        glm::mat4 translateCoins = glm::translate(glm::vec3(boardX(game.board.cellX(cell)), 0.5f, boardZ(game.board.cellZ(cell)))); // glTranslatef
         glm::mat4 scaleCoins = glm::scale(glm::vec3(0.3f, 0.3f, 0.3f));
         //glm::mat4 HoverTransform = translateTriangle * rotateTriangle;
         Matrices.model *= (translateCoins * scaleCoins);
-        //Matrices.view = glm::lookAt(glm::vec3(0.5, 2, 7), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-        VP = Matrices.projection * Matrices.view;
         MVP = VP * Matrices.model; // MVP = p * V * M
-        //  Don't change unless you are sure!!
-        // Copy MVP to normal shaders
-        glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-        draw3DObject(coins[i]);
+        submitMesh(LAYER_OBJECTS, coin, MVP);
     }
-    if(level==2 || level==3){
-    for (i = 0; i < 5; i++) {
+    if(game.level==2 || game.level==3){
+    for (i = 0; i < (int)game.fires.size(); i++) {
+        int cell = game.fires[i];
+        if (cell < 0)
+            continue;
         Matrices.model = glm::mat4(1.0f);
-        glm::mat4 translateFire = glm::translate(glm::vec3(-3 + 0.6 * fire_x[i], 0.3f, 0.6 * fire_z[i]));
+        glm::mat4 translateFire = glm::translate(glm::vec3(boardX(game.board.cellX(cell)), 0.3f, boardZ(game.board.cellZ(cell))));
         glm::mat4 scaleFire = glm::scale(glm::vec3(0.3f, 0.3f, 0.3f));
         Matrices.model *= (translateFire * scaleFire);
-        VP = Matrices.projection * Matrices.view;
         MVP = VP * Matrices.model;
-        glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-        draw3DObject(fire[i]);
+        submitMesh(LAYER_OBJECTS, fire, MVP);
     }
 	}
+    obstacles_scope.stop();
+
+    ProfileScope player_scope(PROFILE_PLAYER);
 
-    if ((10 * pz + px == tile[0]) || (10 * pz + px == tile[1]) || (10 * pz + px == tile[2]) || (10 * pz + px == tile[3]) || (10 * pz + px == tile[4])) {
-        if (cy + 0.5 > 0.5 + ry && !on_tile) {
-            health -= 5;
-            if (dir == 1)
-                pz += 1;
-            else if (dir == 4)
-                pz -= 1;
-            else if (dir == 2)
-                px += 1;
-            else if (dir == 3)
-                px -= 1;
-        }
-        else if (cy + 0.5 <= 0.5 + ry){
-	    if(!on_tile && cy+0.75<=0.5+ry)
-		health-=5;
-            on_tile = true;
-	}
-    }
-    else
-        on_tile = false;
-    if (dir == 1) {
-        if ((10 * (pz - 1) + px == tile[0]) || (10 * (pz - 1) + px == tile[1]) || (10 * (pz - 1) + px == tile[2]) || (10 * (pz - 1) + px == tile[3]) || (10 * (pz - 1) + px == tile[4])) {
-            if (cy + 0.5 > 0.5 + ry && !on_tile && jump) {
-                health -= 5;
-                jump = false;
-                ry = 0;
-            }
-        }
-    }
-    if (dir == 4) {
-        if ((10 * (pz + 1) + px == tile[0]) || (10 * (pz + 1) + px == tile[1]) || (10 * (pz + 1) + px == tile[2]) || (10 * (pz + 1) + px == tile[3]) || (10 * (pz + 1) + px == tile[4])) {
-            if (cy + 0.5 > 0.5 + ry && !on_tile && jump) {
-                health -= 5;
-                jump = false;
-                ry = 0;
-            }
-        }
-    }
-    if (dir == 2) {
-        if ((10 * pz + px - 1 == tile[0]) || (10 * pz + px - 1 == tile[1]) || (10 * pz + px - 1 == tile[2]) || (10 * pz + px - 1 == tile[3]) || (10 * pz + px - 1 == tile[4])) {
-            if (cy + 0.5 > 0.5 + ry && !on_tile && jump) {
-                health -= 5;
-                jump = false;
-                ry = 0;
-            }
-        }
-    }
-    if (dir == 3) {
-        if ((10 * pz + px + 1 == tile[0]) || (10 * pz + px + 1 == tile[1]) || (10 * pz + px + 1 == tile[2]) || (10 * pz + px + 1 == tile[3]) || (10 * pz + px + 1 == tile[4])) {
-            if (cy + 0.5 > 0.5 + ry && !on_tile && jump) {
-                health -= 5;
-                jump = false;
-                ry = 0;
-            }
-        }
-    }
-    glUseProgram(programID);
     Matrices.model = glm::mat4(1.0f);
     glm::mat4 translatePlayer;
     /* Render your scene */
-    if (dir == 1) {
-        if (on_tile)
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px, 0.5f + ry + cy, 0.6f * pz - rx)); // glTranslatef
+    if (game.dir == 1) {
+        if (game.on_tile)
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px), 0.5f + view.ry + view.cy, boardZ(view.pz) - view.rx)); // glTranslatef
         else
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px, 0.5f + ry, 0.6f * pz - rx));
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px), 0.5f + view.ry, boardZ(view.pz) - view.rx));
     }
-    else if (dir == 4) {
-        if (on_tile)
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px, 0.5f + ry + cy, 0.6f * pz + rx)); // glTranslatef
+    else if (game.dir == 4) {
+        if (game.on_tile)
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px), 0.5f + view.ry + view.cy, boardZ(view.pz) + view.rx)); // glTranslatef
         else
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px, 0.5f + ry, 0.6f * pz + rx));
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px), 0.5f + view.ry, boardZ(view.pz) + view.rx));
     }
-    else if (dir == 2) {
-        if (on_tile)
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px - rx, 0.5f + ry + cy, 0.6f * pz)); // glTranslatef
+    else if (game.dir == 2) {
+        if (game.on_tile)
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px) - view.rx, 0.5f + view.ry + view.cy, boardZ(view.pz))); // glTranslatef
         else
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px - rx, 0.5f + ry, 0.6f * pz));
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px) - view.rx, 0.5f + view.ry, boardZ(view.pz)));
     }
-    else if (dir == 3) {
-        if (on_tile)
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px + rx, 0.5f + ry + cy, 0.6f * pz)); // glTranslatef
+    else if (game.dir == 3) {
+        if (game.on_tile)
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px) + view.rx, 0.5f + view.ry + view.cy, boardZ(view.pz))); // glTranslatef
         else
-            translatePlayer = glm::translate(glm::vec3(-3 + 0.6f * px + rx, 0.5f + ry, 0.6f * pz));
+            translatePlayer = glm::translate(glm::vec3(boardX(view.px) + view.rx, 0.5f + view.ry, boardZ(view.pz)));
     }
     glm::mat4 scalePlayer = glm::scale(glm::vec3(0.2f, 0.2f, 0.2f));
     Matrices.model *= (translatePlayer * scalePlayer);
@@ -2176,9 +1542,11 @@ void gamescreen()
     //  	z = cos(glfwGetTime());
     MVP = VP * Matrices.model; // MVP = p * V * M
     //  Don't change unless you are sure!!
-    // Copy MVP to normal shaders
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-    draw3DObject(player);
+    submitMesh(LAYER_PLAYER, player, MVP);
+    player_scope.stop();
+
+    if (profiler.enabled())
+        submitProfile(Matrices.projection * Matrices.view);
 }
 
 void endscreen()
@@ -2186,10 +1554,6 @@ void endscreen()
     // clear the color and depth in the frame buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // use the loaded shader program
-    // Don't change unless you know what you are doing
-    glUseProgram(programID);
-
     static float c = 0;
     c++;
     //Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(sinf(c*M_PI/180.0),3*cosf(c*M_PI/180.0),0)); // Fixed camera for 2D (ortho) in XY plane
@@ -2198,121 +1562,30 @@ void endscreen()
     //  Don't change unless you are sure!!
     glm::mat4 VP = Matrices.projection * Matrices.view;
 
-    // Send our transformation to the currently bound shader, in the "MVP" uniform
-    // For each model you render, since the MVP will be different (at least the M part)
-    //  Don't change unless you are sure!!
-    glm::mat4 MVP; // MVP = Projection * View * Model
-
-    // Render with texture shaders now
-    glUseProgram(textureProgramID);
-
-    // Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
-    // glPopMatrix ();
-    Matrices.model = glm::mat4(1.0f);
-    MVP = VP * Matrices.model;
-
-    // Copy MVP to texture shaders
-    glUniformMatrix4fv(Matrices.TexMatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // Set the texture sampler to access Texture0 memory
-    glUniform1i(glGetUniformLocation(textureProgramID, "texSampler"), 0);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DTexturedObject(rectangle);
-
     if (hover_flag == 5)
         hover_y = 0;
     else if (hover_flag == 6) {
         hover_y = -1;
     }
-    // Load identity to model matrix
-    Matrices.model = glm::mat4(1.0f);
 
-    /* Render your scene */
-    glm::mat4 translateHover = glm::translate(glm::vec3(-0.1f, 0.15f + hover_y, 0.0f)); // glTranslatef
-    glm::mat4 scaleHover = glm::scale(glm::vec3(4.f, 1.f, 0.f));
-    //glm::mat4 HoverTransform = translateTriangle * rotateTriangle;
-    Matrices.model *= (translateHover * scaleHover);
-    MVP = VP * Matrices.model; // MVP = p * V * M
-
-    //  Don't change unless you are sure!!
-    // Copy MVP to normal shaders
-    glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-    // draw3DObject draws the VAO given to it using current MVP matrix
-    draw3DObject(hover);
-
-    // Increment angles
-    float increments = 1;
-
-    // Render font on screen
-    glm::vec3 fontColor = getRGBfromHue(0);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateTitle = glm::translate(glm::vec3(-1.5, 3, 0));
-    Matrices.model *= translateTitle;
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor[0]);
-
-    // Render font
-    GL3Font.font->Render("Your Score");
-
-    glm::vec3 fontColor4 = getRGBfromHue(170);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateScore = glm::translate(glm::vec3(-0.3, 2, 0));
-    glm::mat4 scaleScore = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateScore * scaleScore);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor4[0]);
-    // Render font
-    if (score_display_flag == 1)
-        GL3Font.font->Render(score_string);
-
-    glm::vec3 fontColor1 = getRGBfromHue(100);
-
-    // Use font Shaders for next part of code
-    glUseProgram(fontProgramID);
-    Matrices.view = glm::lookAt(glm::vec3(0, 0, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)); // Fixed camera for 2D (ortho) in XY plane
-
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateNewGame = glm::translate(glm::vec3(-1, 0, 0));
-    glm::mat4 scaleNewGame = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateNewGame * scaleNewGame);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor1[0]);
-    // Render font
-    GL3Font.font->Render("Menu");
-
-    glm::vec3 fontColor3 = getRGBfromHue(200);
-    // Transform the text
-    Matrices.model = glm::mat4(1.0f);
-    glm::mat4 translateQuit = glm::translate(glm::vec3(-1, -1, 0));
-    glm::mat4 scaleQuit = glm::scale(glm::vec3(0.75, 0.75, 1));
-    Matrices.model *= (translateQuit * scaleQuit);
-    MVP = Matrices.projection * Matrices.view * Matrices.model;
-    // send font's MVP and font color to fond shaders
-    glUniformMatrix4fv(GL3Font.fontMatrixID, 1, GL_FALSE, &MVP[0][0]);
-    glUniform3fv(GL3Font.fontColorID, 1, &fontColor3[0]);
-    // Render font
-    GL3Font.font->Render("Quit");
+    // The background and the highlight over it, laid out once; afterwards
+    // only the highlight moves
+    if (endSprites.empty()) {
+        endSprites.add("space4.jpg", 0, 0, 8, 8);
+        endHoverSlot = endSprites.add("solid", -0.1f, 0.15f, 2, 0.5f, glm::vec3(1, 1, 0));
+    }
+    endSprites.place(endHoverSlot, -0.1f, 0.15f + hover_y, 2, 0.5f);
+    submitSprites(LAYER_BACKGROUND, endSprites, VP);
+
+    // Lay out the end screen text once
+    if (endText.empty()) {
+        endText.add("Your Score", -1.5, 3, 1, getRGBfromHue(0));
+        endScoreSlot = endText.add("", -0.3, 2, 0.75, getRGBfromHue(170));
+        endText.add("Menu", -1, 0, 0.75, getRGBfromHue(100));
+        endText.add("Quit", -1, -1, 0.75, getRGBfromHue(200));
+    }
+    endText.set(endScoreSlot, score_display_flag == 1 ? score_string : "", 3);
+    submitText(endText, VP);
 }
 
 /* Initialise glfw window, I/O callbacks and the renderer to use */
@@ -2330,6 +1603,8 @@ GLFWwindow* initGLFW(int width, int height)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // The benchmark never needs to be seen, which also lets it run on a virtual display
+    glfwWindowHint(GLFW_VISIBLE, bench_seconds > 0 ? GLFW_FALSE : GLFW_TRUE);
 
     window = glfwCreateWindow(width, height, "G R A V I T Y", NULL, NULL);
 
@@ -2340,7 +1615,7 @@ GLFWwindow* initGLFW(int width, int height)
 
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-    glfwSwapInterval(1);
+    glfwSwapInterval(vsync ? 1 : 0);
 
     /* --- register callbacks with GLFW --- */
 
@@ -2363,54 +1638,58 @@ GLFWwindow* initGLFW(int width, int height)
     return window;
 }
 
-/* Initialize the OpenGL rendering properties */
-/* Add all the models to be created here */
-void initGL(GLFWwindow* window, int width, int height)
+/* What every screen draws with : the shared programs, the UI sprite atlas */
+/* and the font. Only these hold up the first frame */
+void createCommonResources(GLFWwindow* window, int width, int height)
 {
-    // Load Textures
+    static bool created = false;
+    if (created)
+        return;
+    created = true;
+
     // Enable Texture0 as current texture memory
     glActiveTexture(GL_TEXTURE0);
-    // load an image file directly as a new OpenGL texture
-    // GLuint texID = SOIL_load_OGL_texture ("beach.png", SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, SOIL_FLAG_TEXTURE_REPEATS); // Buggy for OpenGL3
-    GLuint textureID, textureID1;
-    if (sc_flag == 0)
-        textureID = createTexture("space1.jpg");
-    else if (sc_flag == 1)
-        textureID = createTexture("space2.jpg");
-    else if (sc_flag == 3) {
-        if (init_flag == 1)
-            textureID = createTexture("loading.jpg");
-        else
-            textureID = createTexture("space3.jpg");
+
+    {
+        StartupScope scope(STARTUP_SHADERS);
+        // Create and compile our GLSL program from the sprite shaders
+        spriteProgram = resources.program("Sprite.vert", "Sprite.frag");
+        // Set the texture sampler to access Texture0 memory, once for the program's lifetime
+        glUseProgram(spriteProgram->id());
+        glUniform1i(spriteProgram->location(UNIFORM_TEX_SAMPLER), 0);
+
+        // Create and compile our GLSL program from the shaders
+        colorProgram = resources.program("Sample_GL3.vert", "Sample_GL3.frag");
+
+        // Create and compile our GLSL program from the text shaders
+        textProgram = resources.program("TextAtlas.vert", "TextAtlas.frag");
+        glUseProgram(textProgram->id());
+        glUniform1i(textProgram->location(UNIFORM_TEX_SAMPLER), 0);
+
+        if (!colorProgram->valid() || !spriteProgram->valid() || !textProgram->valid()) {
+            releaseResources();
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        // Every background, icon and flat quad of the 2D screens, packed
+        // offline by atlaspack into the layers of one array texture. Only the
+        // start menu's layers go up now, the other screens' follow on first
+        // use or behind the loading screen
+        StartupScope scope(STARTUP_TEXTURES);
+        uiAtlas = resources.atlas("ui.gatlas");
+        if (!uiAtlas) {
+            releaseResources();
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+        const char* images[] = { "space1.jpg", "solid" };
+        for (int i = 0; i < 2; i++)
+            if (const SpriteAtlas::Sprite* sprite = uiAtlas->sprite(images[i]))
+                uiAtlas->upload((int)sprite->layer);
     }
-    else if (sc_flag == 4)
-        textureID = createTexture("space4.jpg");
-    // check for an error during the load process
-    if (textureID == 0)
-        cout << "SOIL loading error: '" << SOIL_last_result() << "'" << endl;
-    textureID1 = createTexture("lives.jpg");
-    // Create and compile our GLSL program from the texture shaders
-    textureProgramID = LoadShaders("TextureRender.vert", "TextureRender.frag");
-    // Get a handle for our "MVP" uniform
-    Matrices.TexMatrixID = glGetUniformLocation(textureProgramID, "MVP");
-
-    /* Objects should be created before any other gl function and shaders */
-    // Create the models
-    createHover();
-    createDot();
-    createLoadBar();
-    createHealthBar();
-    createCube(100);
-    createCoins(5);
-    createFire(5);
-    createPlayer(); // Generate the VAO, VBOs, vertices data & copy into the array buffer
-    createRectangle(textureID);
-    createLives(textureID1);
-
-    // Create and compile our GLSL program from the shaders
-    programID = LoadShaders("Sample_GL3.vert", "Sample_GL3.frag");
-    // Get a handle for our "MVP" uniform
-    Matrices.MatrixID = glGetUniformLocation(programID, "MVP");
 
     reshapeWindow(window, width, height);
 
@@ -2423,59 +1702,266 @@ void initGL(GLFWwindow* window, int width, int height)
     //glEnable(GL_BLEND);
     //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Initialise FTGL stuff
+    // Rasterize the font once into a glyph atlas
+    StartupScope scope(STARTUP_FONT);
     const char* fontfile = "arial.ttf";
-    GL3Font.font = new FTExtrudeFont(fontfile); // 3D extrude style rendering
+    hudFont = resources.font(fontfile);
 
-    if (GL3Font.font->Error()) {
+    if (!hudFont) {
         //		cout << "Error: Could not load font `" << fontfile << "'" << endl;
         glfwTerminate();
         exit(EXIT_FAILURE);
     }
 
-    // Create and compile our GLSL program from the font shaders
-    fontProgramID = LoadShaders("fontrender.vert", "fontrender.frag");
-    GLint fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform;
-    fontVertexCoordAttrib = glGetAttribLocation(fontProgramID, "vertexPosition");
-    fontVertexNormalAttrib = glGetAttribLocation(fontProgramID, "vertexNormal");
-    fontVertexOffsetUniform = glGetUniformLocation(fontProgramID, "pen");
-    GL3Font.fontMatrixID = glGetUniformLocation(fontProgramID, "MVP");
-    GL3Font.fontColorID = glGetUniformLocation(fontProgramID, "fontColor");
-
-    GL3Font.font->ShaderLocations(fontVertexCoordAttrib, fontVertexNormalAttrib, fontVertexOffsetUniform);
-    GL3Font.font->FaceSize(1);
-    GL3Font.font->Depth(0);
-    GL3Font.font->Outset(0, 0);
-    GL3Font.font->CharMap(ft_encoding_unicode);
-
     //	cout << "VENDOR: " << glGetString(GL_VENDOR) << endl;
     //	cout << "RENDERER: " << glGetString(GL_RENDERER) << endl;
     //	cout << "VERSION: " << glGetString(GL_VERSION) << endl;
     //	cout << "GLSL: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
 }
 
+/* The board, obstacles and player. Looked up once the loader has uploaded */
+/* them while the loading screen is up, or built here on first use */
+void createGameResources()
+{
+    static bool created = false;
+    if (created)
+        return;
+    created = true;
+
+    tiles = resources.mesh("tiles", buildTiles);
+    addInstanceBuffer(tiles, 0); // Sized to the board the first time it is drawn
+    tile_instances_empty = true;
+    coin = resources.mesh("coin", buildCoins);
+    fire = resources.mesh("fire", buildFire);
+    player = resources.mesh("player", buildPlayer); // Generate the VAO, VBOs, vertices data & copy into the array buffer
+
+    // Create and compile our GLSL program from the instanced tile shaders
+    tileProgram = resources.program("TileInstanced.vert", "Sample_GL3.frag");
+    if (!tileProgram->valid()) {
+        releaseResources();
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Initialize the OpenGL rendering properties */
+/* Called on every screen change: creates what the screens need the first */
+/* time one is shown. Each screen picks its background from the UI atlas */
+void initGL(GLFWwindow* window, int width, int height)
+{
+    createCommonResources(window, width, height);
+}
+
 int main(int argc, char** argv)
 {
     int width = 800;
     int height = 600;
 
-    GLFWwindow* window = initGLFW(width, height);
+    bool headless = false;
+    bool seed_given = false;
+    // --offscreen : no window, frames go to a framebuffer and optionally to disk
+    bool offscreen = false;
+    long frame_limit = -1; // Frames to draw before quitting, -1 for no limit
+    const char* dump_dir = NULL;
+    long dump_every = 1;
+    bool print_timeline = false; // --timeline : the startup timeline on stderr once the menu is up
+    session_seed = ((uint64_t)std::random_device()() << 32) ^ std::random_device()();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-vsync") == 0)
+            vsync = false;
+        else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &board_width, &board_height) != 2 || board_width < 2 || board_height < 2 || board_width > MAX_BOARD_SIZE || board_height > MAX_BOARD_SIZE) {
+                cout << "--board takes WIDTHxHEIGHT, each between 2 and " << MAX_BOARD_SIZE << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_file = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            if (!replay_log.open(argv[++i])) {
+                cout << "Could not read the input log " << argv[i] << endl;
+                exit(EXIT_FAILURE);
+            }
+            replaying = true;
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--timeline") == 0)
+            print_timeline = true;
+        else if (strcmp(argv[i], "--offscreen") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1 || height < 1) {
+                cout << "--offscreen takes WIDTHxHEIGHT" << endl;
+                exit(EXIT_FAILURE);
+            }
+            offscreen = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frame_limit = atol(argv[++i]);
+        else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+            dump_dir = argv[++i];
+        else if (strcmp(argv[i], "--dump-every") == 0 && i + 1 < argc)
+            dump_every = max(atol(argv[++i]), 1L);
+        else if (strcmp(argv[i], "--bench") == 0) {
+            bench_seconds = 5;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                bench_seconds = atof(argv[++i]);
+            if (bench_seconds <= 0) {
+                cout << "--bench takes the seconds to spend in each view" << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            char* end;
+            session_seed = strtoull(argv[++i], &end, 0);
+            seed_given = true;
+            if (*end != '\0') {
+                cout << "--seed takes a number" << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    if (offscreen && frame_limit < 0 && bench_seconds == 0) {
+        cout << "--offscreen needs --frames N or --bench, nothing could ever close it" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (dump_dir && !offscreen) {
+        cout << "--dump only applies to --offscreen" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (headless && !replaying) {
+        cout << "--headless only applies to --replay" << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (headless) {
+        // Step the logged game as fast as possible, nothing is drawn
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        long steps = replayGame(replay_log, game, SIM_DT);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cout << "replayed " << steps << " steps (" << steps * SIM_DT << " s of play) in " << seconds << " s, " << steps / max(seconds, 1e-9) << " steps/s" << endl;
+        cout << "score: " << game.score << endl;
+        if (replay_log.finished() && (!game.over || game.score != replay_log.finalScore())) {
+            cout << "replay diverged from the recording, which ended with score " << replay_log.finalScore() << endl;
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    if (bench_seconds > 0) {
+        // Always the same game unless a seed was given, and as many frames as the machine can draw
+        if (!seed_given)
+            session_seed = 1;
+        vsync = false;
+    }
+    else if (!replaying)
+        cout << "seed: " << session_seed << endl;
+
+    // Assets come out of one mapping when the archive is found, loose files
+    // in the working directory fill in for it otherwise
+    {
+        StartupScope scope(STARTUP_ARCHIVE);
+        pak.open(defaultPakPath().c_str());
+    }
+
+    GLFWwindow* window = NULL;
+    OffscreenTarget offscreen_target;
+    {
+        StartupScope scope(STARTUP_WINDOW);
+        if (!offscreen)
+            window = initGLFW(width, height);
+        else if (!offscreen_target.create(width, height))
+            exit(EXIT_FAILURE);
+    }
+    startup.mark(STARTUP_WINDOW_UP);
 
     //initGL (window, width, height);
 
     //PlaySound("starwars.mp3", NULL, SND_ASYNC|SND_FILENAME|SND_LOOP);
 
-    double last_update_time = glfwGetTime(), current_time;
-    double last_timer_update = glfwGetTime(), timer_update;
-    double xpos, ypos;
-    double xpos_o,ypos_o;
-    glfwGetCursorPos(window, &xpos_o, &ypos_o);
+    double xpos = 0, ypos = 0;
+    double xpos_o = 0, ypos_o = 0;
+    if (window)
+        glfwGetCursorPos(window, &xpos_o, &ypos_o);
     double widthc = width, heightc = height;
-    int level_c = 0;
+    std::chrono::steady_clock::time_point last_frame = std::chrono::steady_clock::now();
+    double sim_accumulator = 0;
+    // A replay or a benchmark plays at once; otherwise the menus come first
+    // and the game, its seed and its log start when the player starts one
+    if (replaying || bench_seconds > 0)
+        newGame();
+    GpuTimer bench_gpu;
+    std::vector<BenchPhase> bench_phases(BENCH_VIEW_COUNT);
+    if (bench_seconds > 0) {
+        // Skip the menus and the loading screen, the game screen is what is measured
+        for (int v = 0; v < BENCH_VIEW_COUNT; v++)
+            bench_phases[v].name = BENCH_VIEWS[v];
+        loading_time = 21;
+        init_flag = 1;
+        sc_flag = 3;
+    }
+    // Every screen draws with these, including the loading screen a replay
+    // or a benchmark starts on before any initGL
+    createCommonResources(window, width, height);
+    if (replaying) {
+        // Skip the menus, the replay starts at once
+        startLoading();
+    }
+    previous_sim = current_sim = captureSim();
+    long frames_drawn = 0;
     /* Draw in loop */
-    while (!glfwWindowShouldClose(window)) {
+    while (window ? !glfwWindowShouldClose(window) : frame_limit < 0 || frames_drawn < frame_limit) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        frame_time = std::chrono::duration<double>(now - last_frame).count();
+        last_frame = now;
+        // Offscreen frames each advance the game by one step, so the same
+        // options always draw the same frames however slow the rasterizer is
+        if (offscreen)
+            frame_time = SIM_DT;
+        int bench_view = -1; // View this frame is measured for, -1 if it is not
+        if (bench_seconds > 0) {
+            int view = benchView();
+            if (view < 0) {
+                std::vector<GpuSample> samples;
+                bench_gpu.collect(samples, true);
+                for (size_t k = 0; k < samples.size(); k++)
+                    bench_phases[samples[k].tag].gpu.push_back(samples[k].ms);
+                std::vector<std::string> settings;
+                settings.push_back("\"renderer\": " + jsonString((const char*)glGetString(GL_RENDERER)));
+                settings.push_back("\"seconds_per_view\": " + std::to_string(bench_seconds));
+                // Offscreen views last a number of frames, not of seconds
+                if (offscreen)
+                    settings.push_back("\"frames_per_view\": " + std::to_string(std::lround(bench_seconds / SIM_DT)));
+                settings.push_back("\"seed\": " + std::to_string(session_seed));
+                settings.push_back("\"board\": " + jsonString(std::to_string(board_width) + "x" + std::to_string(board_height)));
+                writeBenchJson(cout, bench_phases, settings);
+                break;
+            }
+            if (bench_time - view * bench_seconds >= BENCH_WARMUP) {
+                bench_view = view;
+                bench_gpu.begin(view);
+            }
+            bench_time += frame_time;
+        }
 	if(!pause){
-        glfwGetCursorPos(window, &xpos, &ypos);
+        profiler.beginFrame();
+        // Upload what the loader thread prepared; offscreen frames wait for all
+        // of it so the loading screen lasts the same number of frames every run
+        if (offscreen)
+            assetLoader.finish();
+        else
+            assetLoader.pump();
+        // Run as many fixed steps as the real time since the last frame covers
+        ProfileScope simulation_scope(PROFILE_SIMULATION);
+        sim_accumulator += min(frame_time, MAX_FRAME_TIME);
+        while (sim_accumulator >= SIM_DT) {
+            previous_sim = captureSim();
+            simulationStep();
+            current_sim = captureSim();
+            sim_accumulator -= SIM_DT;
+        }
+        sim_alpha = sim_accumulator / SIM_DT;
+        simulation_scope.stop();
+
+        if (window)
+            glfwGetCursorPos(window, &xpos, &ypos);
         // OpenGL Draw commands
         if (sc_flag == 0) {
             if (xpos >= 215 * (widthc / 600) && xpos <= 365 * (widthc / 600) && ypos <= 305 * (heightc / 600) && ypos >= 270 * (heightc / 600))
@@ -2502,117 +1988,30 @@ int main(int argc, char** argv)
             controlsscreen();
         }
         else if (sc_flag == 3) {
-            if (loading_time >= 0 && loading_time <= 20) {
+            if (loading_time >= 0 && loading_time <= 20)
                 init_flag = 1;
-                loading_time += 0.1;
-            }
             if (init_flag == 4) {
                 gamescreen();
-                if (lives == 0 || level==4 || timer==0) {
-                    sc_flag = 4;
-                    hover_flag = 5;
-                    lives = 3;
-		    health=15;
-		    tower_view=false;
-		    top_view=false;
-		    adventure_view=false;
-		    follow_view=false; 
-		    cy=0;
-                }
 		if (ypos-ypos_o > 0)
-			dir=1;
+			pending_inputs.face = DIR_UP;
 		if (ypos-ypos_o < 0)
-			dir=4;
+			pending_inputs.face = DIR_DOWN;
 		if (xpos-xpos_o>0)
-			dir=3;
+			pending_inputs.face = DIR_RIGHT;
 		if (xpos-xpos_o<0)
-			dir=2;
+			pending_inputs.face = DIR_LEFT;
 		xpos_o=xpos;
 		ypos_o=ypos;
-		if(10*pz+px==9 && coin_count==5)
-		{
-			level++;
-			px=0;
-			pz=9;
-			coin_count=0;
-			if(level==2)
-				timer=30;
-			else if(level==3)
-				timer=45;
-			else if(level==4){
-				sc_flag = 4;
-                    		hover_flag = 5;
-                    		lives = 3;
-			}
-                }
-                if (px == coins_x[0] && pz == coins_z[0]) {
-                    score += 10;
-                    coins_x[0] = 100;
-                    coins_z[0] = 100;
-		    coin_count++;
-                }
-                else if (px == coins_x[1] && pz == coins_z[1]) {
-                    score += 10;
-                    coins_x[1] = 100;
-                    coins_z[1] = 100;
-		    coin_count++;
-                }
-                else if (px == coins_x[2] && pz == coins_z[2]) {
-                    score += 10;
-                    coins_x[2] = 100;
-                    coins_z[2] = 100;
-                }
-                else if (px == coins_x[3] && pz == coins_z[3]) {
-                    score += 10;
-                    coins_x[3] = 100;
-                    coins_z[3] = 100;
-		    coin_count++;
-		    coin_count++;
-                }
-                else if (px == coins_x[4] && pz == coins_z[4]) {
-                    score += 10;
-                    coins_x[4] = 100;
-                    coins_z[4] = 100;
-		    coin_count++;
-                }
-                if (px == fire_x[0] && pz == fire_z[0]) {
-                    health -= 0.1;
-                }
-                else if (px == fire_x[1] && pz == fire_z[1]) {
-                    health -= 0.1;
-                }
-                else if (px == fire_x[2] && pz == fire_z[2]) {
-                    health -= 0.1;
-                }
-                else if (px == fire_x[3] && pz == fire_z[3]) {
-                    health -= 0.1;
-                }
-                else if (px == fire_x[4] && pz == fire_z[4]) {
-                    health -= 0.1;
-                }
             }
             else if (init_flag != 4){
                 loading_effect();
-		level_c=0;
-		level=1;
-		timer=15;
-		health=15;
-		cy=0;
-	    }
+            }
             if (init_flag == 1 || init_flag == 3) {
                 initGL(window, width, height);
                 init_flag = 4;
                 if (loading_time > 20)
                     initGL(window, width, height);
             }
-            if (level_c != level) {
-                int i;
-                for (i = 0; i < 5; i++) {
-                    coins_x[i] = rand() % 10;
-                    coins_z[i] = rand() % 10;
-                }
-                level_c = level;
-            }
         }
         else if (sc_flag == 4) {
             if (xpos >= 215 * (widthc / 600) && xpos <= 365 * (widthc / 600) && ypos <= 305 * (heightc / 600) && ypos >= 270 * (heightc / 600))
@@ -2629,39 +2028,48 @@ int main(int argc, char** argv)
             }
             endscreen();
         }
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-        current_time = glfwGetTime();
-	timer_update = glfwGetTime();
-        if ((current_time - last_update_time) >= 5) {
-            int i;
-            for (i = 0; i < 5; i++) {
-                hole[i] = rand() % 100;
-                if (hole[i] == (pz * 10 + px) || hole[i] == 90)
-                    hole[i] = 37;
-		if(level==3){
-                tile[i] = rand() % 100;
-		}
-		if(level==2 || level==3){
-                fire_x[i] = rand() % 10;
-                fire_z[i] = rand() % 10;
-                if (fire_z[i] * 10 + fire_x[i] == tile[i])
-                    tile[i] == 100;
-                if (fire_x[i] == px && fire_z[i] == pz) {
-                    fire_x[i] = 8;
-                    fire_z[i] = 7;
-		}
-                }
-            }
-            last_update_time = current_time;
+        // Execute everything the screen queued this frame
+        ProfileScope flush_scope(PROFILE_FLUSH);
+        renderQueue.flush();
+        flush_scope.stop();
+        profiler.endFrame();
+        if (print_render_stats) {
+            const RenderStats& stats = renderQueue.stats();
+            cout << "draws: " << stats.draws << " state changes: " << stats.stateChanges << " avoided: " << stats.stateChangesAvoided
+                 << " chunks tested: " << tile_culling.chunksTested << " drawn: " << tile_culling.chunksDrawn << endl;
+            tile_culling = CullStats(); // Screens without a board report nothing
         }
-	if((timer_update - last_timer_update) >=1){
-		timer-=1;
-		last_timer_update=timer_update;
-	}
+        if (bench_view >= 0) {
+            // CPU time is everything up to the swap, which only waits on the GPU
+            bench_gpu.end();
+            bench_phases[bench_view].cpu.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count());
+            std::vector<GpuSample> samples;
+            bench_gpu.collect(samples);
+            for (size_t k = 0; k < samples.size(); k++)
+                bench_phases[samples[k].tag].gpu.push_back(samples[k].ms);
+        }
+        if (window)
+            glfwSwapBuffers(window);
+        else if (dump_dir && frames_drawn % dump_every == 0) {
+            char file[4096];
+            snprintf(file, sizeof(file), "%s/frame_%06ld.ppm", dump_dir, frames_drawn);
+            offscreen_target.dump(file);
+        }
+        frames_drawn++;
+        startup.mark(STARTUP_FIRST_FRAME);
 	}
+        // Outside the pause check, otherwise a paused game never sees the key that resumes it
+        if (window)
+            glfwPollEvents();
+        if (!startup.reached(STARTUP_INTERACTIVE)) {
+            startup.mark(STARTUP_INTERACTIVE);
+            if (print_timeline)
+                startup.report(cerr);
+        }
     }
 
+    releaseResources();
+    offscreen_target.release();
     glfwTerminate();
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,17 @@
+#version 330 core
+
+// Interpolated values from the vertex shaders
+in vec3 fragColor;
+in vec3 fragTexCoord;
+
+// output data
+out vec3 color;
+
+// Every UI image, one layer of the array per page of the atlas
+uniform sampler2DArray texSampler;
+
+void main()
+{
+    // Images are drawn white, flat quads use the atlas' solid sprite
+    color = texture(texSampler, fragTexCoord).rgb * fragColor;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+// input data : sent from main program
+layout (location = 0) in vec2 vertexPosition;
+layout (location = 1) in vec3 vertexColor;
+layout (location = 2) in vec3 vertexTexCoord; // s, t and the atlas layer
+
+uniform mat4 MVP;
+
+// output data : used by fragment shader
+out vec3 fragColor;
+out vec3 fragTexCoord;
+
+void main ()
+{
+    fragColor = vertexColor;
+    fragTexCoord = vertexTexCoord;
+
+    // Output position of the vertex, in clip space : MVP * position
+    gl_Position = MVP * vec4(vertexPosition, 0, 1);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+// Interpolated values from the vertex shaders
+in vec3 fragColor;
+in vec2 fragTexCoord;
+
+// output data
+out vec3 color;
+
+// Glyph coverage, one channel
+uniform sampler2D texSampler;
+
+void main()
+{
+    // Blending is off, so keep the covered half of each glyph edge for solid text
+    if (texture(texSampler, fragTexCoord).r < 0.5)
+        discard;
+    color = fragColor;
+}
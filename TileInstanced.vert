@@ -0,0 +1,29 @@
+#version 330 core
+
+// input data : sent from main program
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 1) in vec3 vertexColor;
+
+// per-instance data : x offset, z offset, moving-tile flag, hole flag
+layout (location = 3) in vec4 tileInstance;
+
+uniform mat4 VP;
+uniform float tileScale;
+uniform float tileLift;
+
+// output data : used by fragment shader
+out vec3 fragColor;
+
+void main ()
+{
+    // Holes collapse to a single point so they produce no fragments
+    float s = tileScale * (1.0 - tileInstance.w);
+
+    // Moving tiles are lifted by the shared up/down offset
+    vec3 p = vertexPosition * s + vec3(tileInstance.x, tileInstance.z * tileLift, tileInstance.y);
+
+    fragColor = vertexColor;
+
+    // Output position of the vertex, in clip space : VP * position
+    gl_Position = VP * vec4(p, 1);
+}
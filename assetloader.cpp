@@ -0,0 +1,152 @@
+#include "assetloader.h"
+
+#include <memory>
+
+#include "sprites.h"
+
+using namespace std;
+
+AssetLoader assetLoader;
+
+AssetLoader::AssetLoader()
+    : stopping(false)
+    , queued(0)
+    , done(0)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    // The GL context is gone by now, only the thread is left to stop
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        wake.notify_all();
+    }
+    if (worker.joinable())
+        worker.join();
+}
+
+void AssetLoader::queue(function<void()> prepare, function<void()> finish)
+{
+    lock_guard<mutex> guard(lock);
+    if (done == queued)
+        done = queued = 0; // Progress restarts with each batch
+    Job job = { prepare, finish };
+    waiting.push_back(job);
+    queued++;
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = thread(&AssetLoader::run, this);
+    }
+    wake.notify_one();
+}
+
+void AssetLoader::queueAtlasLayer(SpriteAtlas* atlas, int layer)
+{
+    if (atlas->resident(layer))
+        return;
+    queue(
+        [=]() { atlas->prefetch(layer); },
+        [=]() {
+            if (!pixelBuffer.id())
+                pixelBuffer.create();
+            atlas->upload(layer, pixelBuffer.id());
+        });
+}
+
+void AssetLoader::queueMesh(const string& name, ResourceCache::MeshBuilder build)
+{
+    shared_ptr<MeshData> data(new MeshData);
+    queue(
+        [=]() { build(*data); },
+        [=]() { resources.mesh(name, *data); });
+}
+
+void AssetLoader::queueProgram(const string& vertex_file, const string& fragment_file)
+{
+    // The driver's strings can only be read here, on the GL thread
+    string driver = programCacheDriver();
+    shared_ptr<ProgramSource> source(new ProgramSource);
+    shared_ptr<bool> found(new bool(false));
+    queue(
+        [=]() { *found = readProgram(vertex_file.c_str(), fragment_file.c_str(), driver, *source); },
+        [=]() {
+            if (*found)
+                resources.program(*source);
+        });
+}
+
+void AssetLoader::pump(int limit)
+{
+    for (int i = 0; i < limit; i++) {
+        Job job;
+        {
+            lock_guard<mutex> guard(lock);
+            if (ready.empty())
+                return;
+            job = ready.front();
+            ready.pop_front();
+        }
+        job.finish();
+        lock_guard<mutex> guard(lock);
+        done++;
+    }
+}
+
+void AssetLoader::finish()
+{
+    while (!idle()) {
+        {
+            unique_lock<mutex> guard(lock);
+            prepared.wait(guard, [this]() { return !ready.empty(); });
+        }
+        pump();
+    }
+}
+
+float AssetLoader::progress() const
+{
+    lock_guard<mutex> guard(lock);
+    return queued ? (float)done / queued : 1;
+}
+
+bool AssetLoader::idle() const
+{
+    lock_guard<mutex> guard(lock);
+    return done == queued;
+}
+
+void AssetLoader::release()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        waiting.clear();
+        ready.clear();
+        done = queued = 0;
+        wake.notify_all();
+    }
+    if (worker.joinable())
+        worker.join();
+    // A job the thread was preparing lands in ready on its way out
+    ready.clear();
+    pixelBuffer.reset();
+}
+
+void AssetLoader::run()
+{
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this]() { return stopping || !waiting.empty(); });
+        if (stopping)
+            return;
+        Job job = waiting.front();
+        waiting.pop_front();
+        guard.unlock();
+        job.prepare();
+        guard.lock();
+        ready.push_back(job);
+        prepared.notify_all();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "glresource.h"
+#include "resources.h"
+
+/* Loads assets behind the loading screen. Each job has a CPU part that runs */
+/* on a background thread (reading pixels in, building vertex data) and a GL */
+/* part that runs on the render thread from pump(), a few per frame, so */
+/* neither the CPU work nor the upload holds up a frame */
+class AssetLoader {
+public:
+    AssetLoader();
+    ~AssetLoader();
+
+    /* Queue a job; prepare runs on the loader thread and must not touch GL, */
+    /* finish runs afterwards on the GL thread */
+    void queue(std::function<void()> prepare, std::function<void()> finish);
+
+    /* Queue the upload of an atlas layer : its pixels are read in on the */
+    /* loader thread and reach the GPU through a pixel buffer. Nothing to do */
+    /* if the layer is up by then */
+    void queueAtlasLayer(SpriteAtlas* atlas, int layer);
+
+    /* Queue a mesh for the resource cache : its vertices are merged on the */
+    /* loader thread, only the buffer upload is left for the GL thread */
+    void queueMesh(const std::string& name, ResourceCache::MeshBuilder build);
+
+    /* Queue a program for the resource cache : its shaders and cached */
+    /* binary are read on the loader thread, the GL thread links it */
+    void queueProgram(const std::string& vertex_file, const std::string& fragment_file);
+
+    /* Run the GL part of the jobs the thread has prepared, at most limit of */
+    /* them; call once a frame on the GL thread */
+    void pump(int limit = 1);
+
+    /* Block until every queued job is done; for runs that must not depend */
+    /* on timing, like offscreen captures */
+    void finish();
+
+    /* Share of the jobs queued since the loader was last idle that are done */
+    float progress() const;
+    bool idle() const;
+
+    /* Stop the thread, dropping the jobs not done yet, and free the pixel */
+    /* buffer; must run while the GL context is still current */
+    void release();
+
+private:
+    struct Job {
+        std::function<void()> prepare;
+        std::function<void()> finish;
+    };
+
+    AssetLoader(const AssetLoader&);
+    AssetLoader& operator=(const AssetLoader&);
+
+    void run();
+
+    std::thread worker; // Started by the first job
+    mutable std::mutex lock;
+    std::condition_variable wake; // A job was queued, or stopping was set
+    std::condition_variable prepared; // A job moved to ready
+    std::deque<Job> waiting; // Not prepared yet
+    std::deque<Job> ready; // Prepared, waiting for pump
+    bool stopping;
+    int queued, done; // Jobs since the loader was last idle
+    GLBuffer pixelBuffer; // Atlas layer uploads are staged here
+};
+
+extern AssetLoader assetLoader;
+
+#endif
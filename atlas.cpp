@@ -0,0 +1,238 @@
+#include "atlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char MAGIC[4] = { 'G', 'A', 'T', 'L' };
+
+/* A row of a layer, as tall as the first image put on it */
+struct Shelf {
+    int layer;
+    int y, height;
+    int x; // Where the next image goes
+};
+
+/* Halve an RGB8 image : each pixel of the w x h source's dw x dh */
+/* reduction is the average of the 2x2 block it covers, edges clamped */
+static void downsample(const vector<unsigned char>& src, int w, int h, vector<unsigned char>& dst, int dw, int dh)
+{
+    dst.resize((size_t)dw * dh * 3);
+    for (int y = 0; y < dh; y++)
+        for (int x = 0; x < dw; x++) {
+            int x0 = min(2 * x, w - 1), x1 = min(2 * x + 1, w - 1);
+            int y0 = min(2 * y, h - 1), y1 = min(2 * y + 1, h - 1);
+            for (int c = 0; c < 3; c++) {
+                int sum = src[((size_t)y0 * w + x0) * 3 + c] + src[((size_t)y0 * w + x1) * 3 + c]
+                    + src[((size_t)y1 * w + x0) * 3 + c] + src[((size_t)y1 * w + x1) * 3 + c];
+                dst[((size_t)y * dw + x) * 3 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+}
+
+/* Copy an image into a layer at (x, y), repeating its edge pixels over */
+/* half the padding around it so filtering never reaches a neighbour */
+static void blit(vector<unsigned char>& layer, int width, int height, const AtlasImage& image, int x, int y)
+{
+    const int border = GATLAS_PADDING / 2;
+    int x0 = max(x - border, 0), x1 = min(x + image.width + border, width);
+    int y0 = max(y - border, 0), y1 = min(y + image.height + border, height);
+    for (int ty = y0; ty < y1; ty++) {
+        int sy = min(max(ty - y, 0), image.height - 1);
+        for (int tx = x0; tx < x1; tx++) {
+            int sx = min(max(tx - x, 0), image.width - 1);
+            memcpy(&layer[((size_t)ty * width + tx) * 3], &image.rgb[((size_t)sy * image.width + sx) * 3], 3);
+        }
+    }
+}
+
+bool writeAtlas(const char* file, int width, int height, const vector<AtlasImage>& images, int& layers)
+{
+    vector<size_t> order(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        const AtlasImage& image = images[i];
+        if (image.name.empty() || image.name.size() >= (size_t)GATLAS_NAME_SIZE) {
+            cerr << "Sprite name too long for an atlas : " << image.name << endl;
+            return false;
+        }
+        if (image.width <= 0 || image.height <= 0 || image.width > width || image.height > height
+            || image.rgb.size() != (size_t)image.width * image.height * 3) {
+            cerr << image.name << " (" << image.width << "x" << image.height << ") does not fit a " << width << "x" << height << " layer" << endl;
+            return false;
+        }
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return images[a].name < images[b].name; });
+    for (size_t i = 1; i < order.size(); i++)
+        if (images[order[i - 1]].name == images[order[i]].name) {
+            cerr << "Two sprites are called " << images[order[i]].name << endl;
+            return false;
+        }
+
+    // Shelf packing group by group, tallest first : an image goes on the first
+    // shelf of its group with room left, else on a new shelf under the last one
+    // of one of the group's layers, else on a new layer
+    vector<GatlasSprite> sprites(images.size());
+    vector<size_t> tallest = order;
+    stable_sort(tallest.begin(), tallest.end(), [&](size_t a, size_t b) {
+        return images[a].group != images[b].group ? images[a].group < images[b].group : images[a].height > images[b].height;
+    });
+    vector<Shelf> shelves;
+    vector<int> top; // First free row of each layer
+    size_t first = 0; // First layer of the group being packed
+    for (size_t i = 0; i < tallest.size(); i++) {
+        const AtlasImage& image = images[tallest[i]];
+        if (i > 0 && image.group != images[tallest[i - 1]].group) {
+            shelves.clear();
+            first = top.size();
+        }
+        Shelf* shelf = NULL;
+        for (size_t s = 0; s < shelves.size() && !shelf; s++)
+            if (image.height <= shelves[s].height && shelves[s].x + image.width <= width)
+                shelf = &shelves[s];
+        if (!shelf) {
+            size_t layer = first;
+            while (layer < top.size() && top[layer] + image.height > height)
+                layer++;
+            if (layer == top.size())
+                top.push_back(0);
+            Shelf fresh = { (int)layer, top[layer], image.height, 0 };
+            top[layer] += image.height + GATLAS_PADDING;
+            shelves.push_back(fresh);
+            shelf = &shelves.back();
+        }
+        GatlasSprite& sprite = sprites[tallest[i]];
+        memset(&sprite, 0, sizeof(sprite));
+        strcpy(sprite.name, image.name.c_str());
+        sprite.layer = shelf->layer;
+        sprite.x = shelf->x;
+        sprite.y = shelf->y;
+        sprite.width = image.width;
+        sprite.height = image.height;
+        shelf->x += image.width + GATLAS_PADDING;
+    }
+    layers = top.size();
+
+    // Level 0 of every layer, then each level halves the one above
+    vector<vector<vector<unsigned char> > > chain(1, vector<vector<unsigned char> >(layers));
+    for (int l = 0; l < layers; l++)
+        chain[0][l].assign((size_t)width * height * 3, 0);
+    for (size_t i = 0; i < images.size(); i++)
+        blit(chain[0][sprites[i].layer], width, height, images[i], sprites[i].x, sprites[i].y);
+
+    GatlasHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = GATLAS_VERSION;
+    header.format = GATLAS_RGB8;
+    header.width = width;
+    header.height = height;
+    header.layers = layers;
+    header.sprites = images.size();
+    vector<GatlasLevel> levels;
+    int w = width, h = height;
+    while (true) {
+        GatlasLevel level = { (uint32_t)w, (uint32_t)h, 0, (uint64_t)w * h * 3 * layers };
+        levels.push_back(level);
+        if ((w == 1 && h == 1) || levels.size() == (size_t)GATLAS_MAX_LEVELS)
+            break;
+        int nw = max(w / 2, 1), nh = max(h / 2, 1);
+        chain.push_back(vector<vector<unsigned char> >(layers));
+        for (int l = 0; l < layers; l++)
+            downsample(chain[chain.size() - 2][l], w, h, chain.back()[l], nw, nh);
+        w = nw;
+        h = nh;
+    }
+    header.levels = levels.size();
+    uint64_t offset = sizeof(GatlasHeader) + levels.size() * sizeof(GatlasLevel) + sprites.size() * sizeof(GatlasSprite);
+    for (size_t i = 0; i < levels.size(); i++) {
+        levels[i].offset = offset;
+        offset += levels[i].bytes;
+    }
+
+    FILE* out = fopen(file, "wb");
+    if (!out) {
+        cerr << "Could not write " << file << endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(&levels[0], sizeof(GatlasLevel), levels.size(), out) == levels.size();
+    // Sorted by name, like the pak's entries
+    for (size_t i = 0; ok && i < order.size(); i++)
+        ok = fwrite(&sprites[order[i]], sizeof(GatlasSprite), 1, out) == 1;
+    for (size_t i = 0; ok && i < chain.size(); i++)
+        for (int l = 0; ok && l < layers; l++)
+            ok = fwrite(&chain[i][l][0], 1, chain[i][l].size(), out) == chain[i][l].size();
+    return fclose(out) == 0 && ok;
+}
+
+AtlasFile::AtlasFile()
+    : data(NULL)
+    , size(0)
+    , head(NULL)
+    , levelTable(NULL)
+    , spriteTable(NULL)
+{
+}
+
+bool AtlasFile::open(const char* file)
+{
+    close();
+    return mapping.open(file) && view(mapping.data(), mapping.size());
+}
+
+bool AtlasFile::open(const unsigned char* bytes, size_t length)
+{
+    close();
+    return view(bytes, length);
+}
+
+bool AtlasFile::view(const unsigned char* bytes, size_t length)
+{
+    if (!bytes || length < sizeof(GatlasHeader)) {
+        close();
+        return false;
+    }
+    data = bytes;
+    size = length;
+    return validate();
+}
+
+bool AtlasFile::validate()
+{
+    head = (const GatlasHeader*)data;
+    levelTable = (const GatlasLevel*)(data + sizeof(GatlasHeader));
+    bool valid = memcmp(head->magic, MAGIC, sizeof(MAGIC)) == 0 && head->version == GATLAS_VERSION && head->format == GATLAS_RGB8
+        && head->layers > 0 && head->levels > 0 && head->levels <= (uint32_t)GATLAS_MAX_LEVELS
+        && head->sprites <= size / sizeof(GatlasSprite)
+        && sizeof(GatlasHeader) + head->levels * sizeof(GatlasLevel) + head->sprites * sizeof(GatlasSprite) <= size;
+    if (valid)
+        spriteTable = (const GatlasSprite*)(levelTable + head->levels);
+    for (uint32_t i = 0; valid && i < head->levels; i++) {
+        const GatlasLevel& level = levelTable[i];
+        valid = level.width == max(head->width >> i, 1u) && level.height == max(head->height >> i, 1u)
+            && level.bytes == (uint64_t)level.width * level.height * 3 * head->layers
+            && level.offset <= size && level.bytes <= size - level.offset;
+    }
+    for (uint32_t i = 0; valid && i < head->sprites; i++) {
+        const GatlasSprite& sprite = spriteTable[i];
+        valid = memchr(sprite.name, 0, GATLAS_NAME_SIZE) != NULL && sprite.layer < head->layers
+            && sprite.width <= head->width && sprite.x <= head->width - sprite.width
+            && sprite.height <= head->height && sprite.y <= head->height - sprite.height;
+    }
+    if (!valid)
+        close();
+    return valid;
+}
+
+void AtlasFile::close()
+{
+    mapping.close();
+    data = NULL;
+    size = 0;
+    head = NULL;
+    levelTable = NULL;
+    spriteTable = NULL;
+}
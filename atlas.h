@@ -0,0 +1,95 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+/* .gatlas : the UI images packed offline by atlaspack into the layers of */
+/* one array texture, so every 2D element of a screen draws with a single */
+/* texture binding. A GatlasHeader, then one GatlasLevel per mip level, */
+/* then one GatlasSprite per image sorted by name, then the pixels : each */
+/* level holds every layer of that size one after the other */
+
+const uint32_t GATLAS_VERSION = 1;
+const uint32_t GATLAS_RGB8 = 1; // 3 bytes per pixel, rows in the order the JPEG loader uploads them
+const int GATLAS_NAME_SIZE = 32; // Including the terminating zero
+const int GATLAS_PADDING = 16; // Gap between sprites, filled by repeating their edge pixels
+const int GATLAS_MAX_LEVELS = 4; // A texel of the smallest level spans 8 pixels, no more than the repeated edge
+
+struct GatlasHeader {
+    char magic[4]; // "GATL"
+    uint32_t version;
+    uint32_t format;
+    uint32_t width, height; // Of every layer
+    uint32_t layers;
+    uint32_t levels;
+    uint32_t sprites;
+};
+
+struct GatlasLevel {
+    uint32_t width, height;
+    uint64_t offset; // From the start of the file
+    uint64_t bytes; // Of all the layers together
+};
+
+struct GatlasSprite {
+    char name[GATLAS_NAME_SIZE]; // The image's file name, without its directory
+    uint32_t layer;
+    uint32_t x, y, width, height; // In pixels of level 0, y down from the first row
+};
+
+/* An RGB8 image to pack, as SOIL decodes it */
+struct AtlasImage {
+    std::string name;
+    int group; // Images of different groups never share a layer
+    int width, height;
+    std::vector<unsigned char> rgb;
+};
+
+/* Shelf-pack images into as many width x height layers as they need, each */
+/* group on layers of its own in increasing order, build the mip chain of */
+/* every layer and write it all to file; false with a message on stderr if */
+/* an image does not fit a layer or two names clash */
+bool writeAtlas(const char* file, int width, int height, const std::vector<AtlasImage>& images, int& layers);
+
+/* A .gatlas file mapped read-only; the pixels are used straight from the mapping */
+class AtlasFile {
+public:
+    AtlasFile();
+
+    /* False if the file is missing, truncated or not a version this code reads */
+    bool open(const char* file);
+
+    /* The same on a .gatlas already in memory, e.g. in the asset archive; */
+    /* the bytes are not copied and must outlive this object */
+    bool open(const unsigned char* bytes, size_t length);
+    void close();
+
+    const GatlasHeader& header() const { return *head; }
+    const GatlasLevel& level(int i) const { return levelTable[i]; }
+    const GatlasSprite& sprite(int i) const { return spriteTable[i]; }
+    const unsigned char* pixels(int i) const { return data + levelTable[i].offset; }
+
+private:
+    AtlasFile(const AtlasFile&);
+    AtlasFile& operator=(const AtlasFile&);
+
+    /* Take bytes as the file's contents and validate them */
+    bool view(const unsigned char* bytes, size_t length);
+
+    /* Check the header, level and sprite tables of the bytes in data */
+    bool validate();
+
+    MappedFile mapping; // Empty when the bytes are someone else's
+    const unsigned char* data;
+    size_t size;
+    const GatlasHeader* head;
+    const GatlasLevel* levelTable;
+    const GatlasSprite* spriteTable;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/* Atlas packer : decodes the UI images once, offline, scales them to the */
+/* size they are drawn at and packs them into the layers of a .gatlas, */
+/* which the game uploads as one array texture. A lone / between images */
+/* starts a new group, packed on layers of its own so the game can upload */
+/* the images of one screen without those of the others. A white "solid" */
+/* sprite is always added to the first group for flat colored quads. */
+/* Usage : ./atlaspack OUTPUT.gatlas WxH IMAGE[=WxH] [/] ... */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <SOIL/SOIL.h>
+
+#include "atlas.h"
+
+using namespace std;
+
+/* Name of a file without its directory */
+static string baseName(const string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+/* Scale an RGB8 image to width x height, each pixel the average of the */
+/* source pixels it covers */
+static void resize(const unsigned char* src, int sw, int sh, AtlasImage& image, int width, int height)
+{
+    image.width = width;
+    image.height = height;
+    image.rgb.resize((size_t)width * height * 3);
+    for (int y = 0; y < height; y++) {
+        int y0 = y * sh / height, y1 = max((y + 1) * sh / height, y0 + 1);
+        for (int x = 0; x < width; x++) {
+            int x0 = x * sw / width, x1 = max((x + 1) * sw / width, x0 + 1);
+            unsigned sum[3] = { 0, 0, 0 };
+            for (int sy = y0; sy < y1; sy++)
+                for (int sx = x0; sx < x1; sx++)
+                    for (int c = 0; c < 3; c++)
+                        sum[c] += src[((size_t)sy * sw + sx) * 3 + c];
+            unsigned count = (y1 - y0) * (x1 - x0);
+            for (int c = 0; c < 3; c++)
+                image.rgb[((size_t)y * width + x) * 3 + c] = (unsigned char)((sum[c] + count / 2) / count);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int width, height;
+    if (argc < 4 || sscanf(argv[2], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        cerr << "usage : " << argv[0] << " OUTPUT.gatlas WxH IMAGE[=WxH] [/] ..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<AtlasImage> images;
+    int group = 0;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i], file = arg;
+        if (arg == "/") {
+            group++;
+            continue;
+        }
+        int w = 0, h = 0;
+        size_t equals = arg.rfind('=');
+        if (equals != string::npos) {
+            file = arg.substr(0, equals);
+            if (sscanf(arg.c_str() + equals + 1, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                cerr << "Bad size in " << arg << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        int iw, ih;
+        unsigned char* pixels = SOIL_load_image(file.c_str(), &iw, &ih, 0, SOIL_LOAD_RGB);
+        if (!pixels) {
+            cerr << "Could not decode " << file << " : " << SOIL_last_result() << endl;
+            return EXIT_FAILURE;
+        }
+        images.push_back(AtlasImage());
+        images.back().name = baseName(file);
+        images.back().group = group;
+        resize(pixels, iw, ih, images.back(), w ? w : iw, h ? h : ih);
+        SOIL_free_image_data(pixels);
+    }
+
+    AtlasImage solid;
+    solid.name = "solid";
+    solid.group = 0;
+    solid.width = solid.height = 4;
+    solid.rgb.assign(4 * 4 * 3, 255);
+    images.push_back(solid);
+
+    int layers;
+    if (!writeAtlas(argv[1], width, height, images, layers))
+        return EXIT_FAILURE;
+    cout << images.size() << " sprites in " << layers << " layers of " << width << "x" << height << " -> " << argv[1] << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+Percentiles percentiles(std::vector<double> samples)
+{
+    Percentiles p = { 0, 0, 0, 0 };
+    if (samples.empty())
+        return p;
+    std::sort(samples.begin(), samples.end());
+    const double ranks[3] = { 0.50, 0.95, 0.99 };
+    double* values[3] = { &p.p50, &p.p95, &p.p99 };
+    for (int i = 0; i < 3; i++) {
+        size_t rank = (size_t)std::ceil(ranks[i] * samples.size());
+        *values[i] = samples[std::max(rank, (size_t)1) - 1];
+    }
+    p.max = samples.back();
+    return p;
+}
+
+std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\')
+            quoted += std::string("\\") + (char)c;
+        else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+            quoted += (char)c;
+    }
+    return quoted + "\"";
+}
+
+static void writePercentiles(std::ostream& out, const char* name, const std::vector<double>& samples)
+{
+    Percentiles p = percentiles(samples);
+    out << "\"" << name << "\": {\"p50\": " << p.p50 << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99 << ", \"max\": " << p.max << "}";
+}
+
+void writeBenchJson(std::ostream& out, const std::vector<BenchPhase>& phases, const std::vector<std::string>& settings)
+{
+    out << "{\n";
+    for (size_t i = 0; i < settings.size(); i++)
+        out << "  " << settings[i] << ",\n";
+    out << "  \"modes\": [\n";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const BenchPhase& phase = phases[i];
+        out << "    {\"name\": " << jsonString(phase.name) << ", \"frames\": " << phase.cpu.size() << ", ";
+        writePercentiles(out, "cpu_ms", phase.cpu);
+        out << ", ";
+        writePercentiles(out, "gpu_ms", phase.gpu);
+        out << "}" << (i + 1 < phases.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}" << std::endl;
+}
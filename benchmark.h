@@ -0,0 +1,30 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Nearest-rank percentiles of a set of samples, all 0 when there are none */
+struct Percentiles {
+    double p50, p95, p99, max;
+};
+
+Percentiles percentiles(std::vector<double> samples);
+
+/* Frame times of one phase of a benchmark, in milliseconds */
+struct BenchPhase {
+    std::string name;
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+};
+
+/* Quote text as a JSON string, escaping quotes, backslashes and control */
+/* characters */
+std::string jsonString(const std::string& text);
+
+/* Write the phases as a JSON object, with the percentiles of each phase and */
+/* the run's settings given as ready-made "key": value pairs */
+void writeBenchJson(std::ostream& out, const std::vector<BenchPhase>& phases, const std::vector<std::string>& settings);
+
+#endif
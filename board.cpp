@@ -0,0 +1,37 @@
+#include "board.h"
+
+Board::Board()
+    : w(0)
+    , h(0)
+    , cx(0)
+    , cz(0)
+    , changes(0)
+{
+}
+
+void Board::reset(int width, int height)
+{
+    w = width;
+    h = height;
+    cx = (w + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    cz = (h + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    for (int p = 0; p < CELL_PLANES; p++)
+        planes[p].assign(chunkCount(), 0);
+    changes++;
+}
+
+void Board::set(int cell, CellPlane plane)
+{
+    if (cell < 0 || cell >= cells() || has(cell, plane))
+        return;
+    planes[plane][cell / CHUNK_CELLS] |= (uint64_t)1 << (cell % CHUNK_CELLS);
+    changes++;
+}
+
+void Board::clear(int cell, CellPlane plane)
+{
+    if (!has(cell, plane))
+        return;
+    planes[plane][cell / CHUNK_CELLS] &= ~((uint64_t)1 << (cell % CHUNK_CELLS));
+    changes++;
+}
@@ -0,0 +1,80 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include <vector>
+
+/* What can be on a cell; every kind is one bit plane of the board */
+enum CellPlane {
+    CELL_HOLE,
+    CELL_MOVING,
+    CELL_FIRE,
+    CELL_COIN,
+    CELL_PLANES
+};
+
+/* Largest board side supported */
+const int MAX_BOARD_SIZE = 1024;
+
+/* Per-cell flags of the board, one bit per cell and plane. Obstacles set */
+/* and clear their bits as they move, so asking what is on a cell costs */
+/* the same however many obstacles there are. */
+/* Cells are stored in square chunks of CHUNK_SIZE x CHUNK_SIZE, so a whole */
+/* chunk of one plane is a single 64-bit word and neighbouring cells share */
+/* cache lines in both directions. Cell indices are chunk-major; the chunks */
+/* on the right and bottom edges can hold padding cells that are not inside. */
+class Board {
+public:
+    static const int CHUNK_SIZE = 8;
+    static const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+    Board();
+
+    /* Resize to width x height cells, all flags cleared */
+    void reset(int width, int height);
+
+    int width() const { return w; }
+    int height() const { return h; }
+
+    /* Number of cell indices, padding included */
+    int cells() const { return chunkCount() * CHUNK_CELLS; }
+
+    int chunksX() const { return cx; }
+    int chunksZ() const { return cz; }
+    int chunkCount() const { return cx * cz; }
+
+    /* Cell index and its coordinates */
+    int cell(int x, int z) const
+    {
+        int chunk = (z / CHUNK_SIZE) * cx + x / CHUNK_SIZE;
+        return chunk * CHUNK_CELLS + (z % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE;
+    }
+    int cellX(int cell) const { return (cell / CHUNK_CELLS) % cx * CHUNK_SIZE + cell % CHUNK_SIZE; }
+    int cellZ(int cell) const { return (cell / CHUNK_CELLS) / cx * CHUNK_SIZE + cell % CHUNK_CELLS / CHUNK_SIZE; }
+    bool inside(int x, int z) const { return x >= 0 && x < w && z >= 0 && z < h; }
+
+    /* Whether plane is set on cell; cells off the board have nothing on them */
+    bool has(int cell, CellPlane plane) const
+    {
+        if (cell < 0 || cell >= cells())
+            return false;
+        return (planes[plane][cell / CHUNK_CELLS] >> (cell % CHUNK_CELLS)) & 1;
+    }
+
+    /* One plane of a whole chunk, bit i is cell chunk * CHUNK_CELLS + i */
+    uint64_t chunkBits(int chunk, CellPlane plane) const { return planes[plane][chunk]; }
+
+    void set(int cell, CellPlane plane);
+    void clear(int cell, CellPlane plane);
+
+    /* Bumped whenever a bit changes, so views of the board know when to refresh */
+    unsigned revision() const { return changes; }
+
+private:
+    int w, h;
+    int cx, cz; // Chunks across and down
+    std::vector<uint64_t> planes[CELL_PLANES];
+    unsigned changes;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "camera.h"
+
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+/* Seconds it takes to blend from one camera mode to the next */
+static const float TRANSITION_TIME = 0.35f;
+
+Frustum::Frustum(const glm::mat4& vp)
+{
+    // Rows of the matrix combined as in Gribb and Hartmann; glm is column major so vp[c][r]
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++)
+        row[r] = glm::vec4(vp[0][r], vp[1][r], vp[2][r], vp[3][r]);
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = row[3] + row[i];
+        planes[2 * i + 1] = row[3] - row[i];
+    }
+}
+
+bool Frustum::intersects(const glm::vec3& lo, const glm::vec3& hi) const
+{
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4& p = planes[i];
+        // Test the corner furthest along the plane normal
+        glm::vec3 corner(p.x >= 0 ? hi.x : lo.x, p.y >= 0 ? hi.y : lo.y, p.z >= 0 ? hi.z : lo.z);
+        if (p.x * corner.x + p.y * corner.y + p.z * corner.z + p.w < 0)
+            return false;
+    }
+    return true;
+}
+
+Camera::Camera()
+    : current(CAMERA_DEFAULT)
+    , blend(1)
+    , hasPose(false)
+    , viewMatrix(1.0f)
+    , projectionMatrix(1.0f)
+    , viewProjectionMatrix(1.0f)
+{
+}
+
+void Camera::setProjection(const glm::mat4& projection)
+{
+    projectionMatrix = projection;
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+}
+
+void Camera::setMode(CameraMode mode)
+{
+    if (mode == current)
+        return;
+    current = mode;
+    // Start the transition from wherever the camera is right now
+    from = pose;
+    blend = hasPose ? 0 : 1;
+}
+
+Camera::Pose Camera::poseFor(CameraMode mode, const CameraTarget& target)
+{
+    Pose p;
+    p.eye = glm::vec3(0.5, 2, 7);
+    p.target = glm::vec3(0, 0, 0);
+    p.up = glm::vec3(0, 1, 0);
+
+    switch (mode) {
+    case CAMERA_TOWER:
+        p.eye = glm::vec3(0, 10, 10);
+        break;
+    case CAMERA_TOP:
+        p.eye = glm::vec3(0, 10, 0);
+        p.target = glm::vec3(0, 0, 3);
+        // Same view as an up of (0,-1,0), but never opposite to the other modes' up so blends stay well defined
+        p.up = glm::vec3(0, 0, -1);
+        break;
+    case CAMERA_FOLLOW:
+        p.eye = glm::vec3(target.player.x, 5, 7 + target.player.z);
+        p.target = target.player;
+        break;
+    case CAMERA_HELICOPTER:
+        p.eye = glm::vec3(sin(target.orbitAngle * M_PI / 180.0f) * 10, 2, cos(target.orbitAngle * M_PI / 180.0f) * 10);
+        break;
+    case CAMERA_ADVENTURE:
+        p.eye = glm::vec3(target.player.x, target.player.y + 1, target.player.z - 2);
+        p.target = glm::vec3(target.player.x, target.player.y, target.player.z - 2);
+        if (target.dir == 1)
+            p.target.z = target.player.z - 5;
+        else if (target.dir == 4)
+            p.target.z = target.player.z + 5;
+        else if (target.dir == 2)
+            p.target.x = target.player.x - 5;
+        else if (target.dir == 3)
+            p.target.x = target.player.x + 5;
+        break;
+    default:
+        break;
+    }
+    return p;
+}
+
+void Camera::update(const CameraTarget& target, float dt)
+{
+    Pose goal = poseFor(current, target);
+
+    if (blend < 1) {
+        blend += dt / TRANSITION_TIME;
+        if (blend > 1)
+            blend = 1;
+        // Ease in and out of the transition
+        float t = blend * blend * (3 - 2 * blend);
+        pose.eye = glm::mix(from.eye, goal.eye, t);
+        pose.target = glm::mix(from.target, goal.target, t);
+        pose.up = glm::normalize(glm::mix(from.up, goal.up, t));
+    }
+    else
+        pose = goal;
+    hasPose = true;
+
+    viewMatrix = glm::lookAt(pose.eye, pose.target, pose.up);
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+}
@@ -0,0 +1,73 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/* The camera modes of the game screen, in the order they take priority */
+enum CameraMode {
+    CAMERA_DEFAULT,
+    CAMERA_TOWER,
+    CAMERA_TOP,
+    CAMERA_FOLLOW,
+    CAMERA_HELICOPTER,
+    CAMERA_ADVENTURE
+};
+
+/* What the camera needs to know about the world this frame */
+struct CameraTarget {
+    glm::vec3 player; // World position of the player (feet, including jump and tile lift)
+    int dir; // Facing direction of the player : 1 up, 2 left, 3 right, 4 down
+    float orbitAngle; // Helicopter orbit angle in degrees
+};
+
+/* The six clipping planes of a view-projection, each as (normal, distance) */
+/* with the normal pointing into the visible volume */
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    /* False only if the axis-aligned box lies entirely outside one plane */
+    bool intersects(const glm::vec3& lo, const glm::vec3& hi) const;
+};
+
+/* Computes the view and projection once per frame for the active mode */
+/* and blends smoothly from the previous pose when the mode changes */
+class Camera {
+public:
+    Camera();
+
+    void setProjection(const glm::mat4& projection);
+    void setMode(CameraMode mode);
+    CameraMode mode() const { return current; }
+
+    /* Advance the camera by dt seconds and rebuild the cached matrices */
+    void update(const CameraTarget& target, float dt);
+
+    const glm::mat4& view() const { return viewMatrix; }
+    const glm::mat4& projection() const { return projectionMatrix; }
+    const glm::mat4& viewProjection() const { return viewProjectionMatrix; }
+    Frustum frustum() const { return Frustum(viewProjectionMatrix); }
+
+private:
+    struct Pose {
+        glm::vec3 eye;
+        glm::vec3 target;
+        glm::vec3 up;
+    };
+
+    static Pose poseFor(CameraMode mode, const CameraTarget& target);
+
+    CameraMode current;
+    Pose pose; // Pose used for the last computed view
+    Pose from; // Pose the current transition started from
+    float blend; // 0 at the start of a transition, 1 once it has finished
+    bool hasPose;
+
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::mat4 viewProjectionMatrix;
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include "gamestate.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/* Rates of the continuous motion, per second */
+static const float TILE_SPEED = 0.6f; // Height of the moving tiles
+static const float JUMP_SPEED = 6.f; // Time along the jump arc
+static const float FIRE_DAMAGE = 6.f; // Health lost standing in a fire
+
+static const float JUMP_LENGTH = 2.1f; // Time along the arc when the player lands
+static const double RESHUFFLE_PERIOD = 5; // Seconds between obstacle reshuffles
+static const int PLACEMENT_TRIES = 64; // Random cells tried before an obstacle is left off the board
+
+/* Whether plane is set on the cell at (x, z); nothing is off the board */
+static bool at(const GameState& s, int x, int z, CellPlane plane)
+{
+    return s.board.inside(x, z) && s.board.has(s.board.cell(x, z), plane);
+}
+
+/* Cell offset of a direction */
+static void offsetOf(int dir, int& dx, int& dz)
+{
+    dx = dz = 0;
+    if (dir == DIR_UP)
+        dz = -1;
+    else if (dir == DIR_DOWN)
+        dz = 1;
+    else if (dir == DIR_LEFT)
+        dx = -1;
+    else if (dir == DIR_RIGHT)
+        dx = 1;
+}
+
+static int startCell(const GameState& s)
+{
+    return s.board.cell(0, s.board.height() - 1);
+}
+
+/* Move obstacle i of list to cell, keeping its plane in step */
+static void moveObstacle(GameState& s, std::vector<int>& list, int i, int cell, CellPlane plane)
+{
+    s.board.clear(list[i], plane);
+    list[i] = cell;
+    s.board.set(cell, plane);
+}
+
+/* Random cell with nothing of plane on it, other than the avoided ones; -1 if none was found */
+static int freeCell(GameState& s, CellPlane plane, int avoid = -1, int avoid_too = -1)
+{
+    for (int t = 0; t < PLACEMENT_TRIES; t++) {
+        int cell = s.board.cell(s.rng.below(s.board.width()), s.rng.below(s.board.height()));
+        if (!s.board.has(cell, plane) && cell != avoid && cell != avoid_too)
+            return cell;
+    }
+    return -1;
+}
+
+/* Take every obstacle of list off the board */
+static void removeAll(GameState& s, std::vector<int>& list, CellPlane plane)
+{
+    for (size_t i = 0; i < list.size(); i++)
+        moveObstacle(s, list, i, -1, plane);
+}
+
+/* Each level draws from its own seed, so its placements come in the same */
+/* order however the levels before it were played */
+static void seedLevel(GameState& s)
+{
+    s.rng.seed(mixSeed(s.seed, s.level));
+}
+
+/* Coins on a level : OBSTACLES, but never more than the cells other than */
+/* the start one */
+static int coinsOn(const Board& board)
+{
+    return min(OBSTACLES, board.width() * board.height() - 1);
+}
+
+static void placeCoins(GameState& s)
+{
+    removeAll(s, s.coins, CELL_COIN);
+    s.coins.assign(coinsOn(s.board), -1);
+    for (size_t i = 0; i < s.coins.size(); i++)
+        moveObstacle(s, s.coins, i, freeCell(s, CELL_COIN), CELL_COIN);
+    // A coin that found no cell is dropped, or the level could never be won
+    s.coins.erase(remove(s.coins.begin(), s.coins.end(), -1), s.coins.end());
+    s.coin_level = s.level;
+}
+
+void reshuffle(GameState& s)
+{
+    int player = s.board.cell(s.px, s.pz);
+    for (size_t i = 0; i < s.holes.size(); i++) {
+        // Never open a hole under the player or on the start cell
+        moveObstacle(s, s.holes, i, freeCell(s, CELL_HOLE, player, startCell(s)), CELL_HOLE);
+    }
+    if (s.level == 3)
+        for (size_t i = 0; i < s.tiles.size(); i++)
+            moveObstacle(s, s.tiles, i, freeCell(s, CELL_MOVING), CELL_MOVING);
+    if (s.level == 2 || s.level == 3)
+        for (size_t i = 0; i < s.fires.size(); i++)
+            moveObstacle(s, s.fires, i, freeCell(s, CELL_FIRE, player), CELL_FIRE);
+}
+
+void resetGame(GameState& s, int width, int height, uint64_t seed)
+{
+    s.seed = seed;
+    s.board.reset(min(max(width, 2), MAX_BOARD_SIZE), min(max(height, 2), MAX_BOARD_SIZE));
+    s.px = 0;
+    s.pz = s.board.height() - 1;
+    s.rx = s.ry = 0;
+    s.dir = DIR_UP;
+    s.jump = false;
+    s.ttime = 0;
+    s.on_tile = false;
+
+    // Small boards keep three quarters of their cells clear, so there is
+    // always a way through
+    long cells = (long)s.board.width() * s.board.height();
+    int area_obstacles = min((long)max(OBSTACLES, (int)(OBSTACLES * cells / 100)), cells / 4);
+    s.holes.assign(area_obstacles, -1);
+    s.tiles.assign(area_obstacles, -1);
+    s.fires.assign(min((long)OBSTACLES, cells / 4), -1);
+    s.coins.clear();
+    s.cy = 0;
+    s.b_m = 0;
+
+    s.health = 15;
+    s.lives = 3;
+    s.level = 1;
+    s.score = 0;
+    s.timer = 15;
+    s.coin_count = 0;
+    s.iteration = 0;
+    s.c_i = 0;
+    s.over = false;
+
+    s.reshuffle_time = 0;
+    s.timer_time = 0;
+    seedLevel(s);
+    reshuffle(s);
+    placeCoins(s);
+}
+
+/* Apply what the player asked for; nothing can be changed mid-jump */
+static void applyInputs(GameState& s, const GameInputs& in)
+{
+    if (in.boost > 0 && s.iteration < 3) {
+        s.iteration++;
+        s.c_i = s.iteration;
+    }
+    else if (in.boost < 0 && s.iteration > 1) {
+        s.iteration--;
+        s.c_i = s.iteration;
+    }
+    if (s.jump)
+        return;
+    if (in.face != DIR_NONE)
+        s.dir = in.face;
+    if (in.move != DIR_NONE) {
+        // Standing on a raised moving tile keeps the player in place
+        if (!(s.on_tile && s.cy <= s.ry)) {
+            int dx, dz;
+            offsetOf(in.move, dx, dz);
+            s.px += dx;
+            s.pz += dz;
+        }
+    }
+    if (in.jump)
+        s.jump = true;
+}
+
+void stepBoost(GameState& s)
+{
+    // Travel one cell per step until the boost is used up
+    if (s.c_i != 0) {
+        int dx, dz;
+        offsetOf(s.dir, dx, dz);
+        s.px += dx;
+        s.pz += dz;
+        s.c_i--;
+    }
+}
+
+void stepMovingTiles(GameState& s, double dt)
+{
+    if (s.level != 3)
+        return;
+    if (s.cy >= 0.5) {
+        s.b_m = 1;
+    }
+    if (s.cy <= -0.5) {
+        s.b_m = 0;
+    }
+    if (s.b_m == 0) {
+        s.cy += TILE_SPEED * dt;
+    }
+    else if (s.b_m == 1) {
+        s.cy -= TILE_SPEED * dt;
+    }
+}
+
+void stepJump(GameState& s, double dt)
+{
+    if (!s.jump)
+        return;
+    s.rx = (0.6 * s.ttime);
+    s.ry = (0.4 * s.ttime) - (0.2 * s.ttime * s.ttime);
+    s.ttime += JUMP_SPEED * dt;
+    if (s.ttime > JUMP_LENGTH) {
+        // A jump lands two cells ahead
+        int dx, dz;
+        offsetOf(s.dir, dx, dz);
+        s.jump = false;
+        s.px += 2 * dx;
+        s.pz += 2 * dz;
+        s.rx = 0;
+        s.ttime = 0;
+    }
+}
+
+void checkFall(GameState& s)
+{
+    if (!s.board.inside(s.px, s.pz) || at(s, s.px, s.pz, CELL_HOLE) || s.health <= 0) {
+        s.lives--;
+        s.px = 0;
+        s.pz = s.board.height() - 1;
+        s.health = 15;
+    }
+}
+
+void checkMovingTiles(GameState& s)
+{
+    int dx, dz;
+    offsetOf(s.dir, dx, dz);
+    if (at(s, s.px, s.pz, CELL_MOVING)) {
+        if (s.cy + 0.5 > 0.5 + s.ry && !s.on_tile) {
+            // Walked into the side of a raised tile, bounce back
+            s.health -= 5;
+            s.px -= dx;
+            s.pz -= dz;
+        }
+        else if (s.cy + 0.5 <= 0.5 + s.ry) {
+            // Landing from too high hurts
+            if (!s.on_tile && s.cy + 0.75 <= 0.5 + s.ry)
+                s.health -= 5;
+            s.on_tile = true;
+        }
+    }
+    else
+        s.on_tile = false;
+    // Jumping into the side of a raised tile ends the jump
+    if (s.dir != DIR_NONE && at(s, s.px + dx, s.pz + dz, CELL_MOVING)) {
+        if (s.cy + 0.5 > 0.5 + s.ry && !s.on_tile && s.jump) {
+            s.health -= 5;
+            s.jump = false;
+            s.ry = 0;
+        }
+    }
+}
+
+void pickUpCoin(GameState& s)
+{
+    if (!at(s, s.px, s.pz, CELL_COIN))
+        return;
+    int cell = s.board.cell(s.px, s.pz);
+    for (size_t i = 0; i < s.coins.size(); i++)
+        if (s.coins[i] == cell)
+            moveObstacle(s, s.coins, i, -1, CELL_COIN);
+    s.score += 10;
+    s.coin_count++;
+}
+
+void applyFireDamage(GameState& s, double dt)
+{
+    if (at(s, s.px, s.pz, CELL_FIRE))
+        s.health -= FIRE_DAMAGE * dt;
+}
+
+void step(GameState& s, const GameInputs& inputs, double dt)
+{
+    applyInputs(s, inputs);
+    stepBoost(s);
+    stepMovingTiles(s, dt);
+    stepJump(s, dt);
+    checkFall(s);
+    checkMovingTiles(s);
+
+    if (s.lives == 0 || s.level == 4 || s.timer == 0) {
+        s.over = true;
+        return;
+    }
+    // The goal is the far corner, once every coin of the level is picked up
+    if (s.px == s.board.width() - 1 && s.pz == 0 && s.coin_count == (int)s.coins.size()) {
+        s.level++;
+        s.px = 0;
+        s.pz = s.board.height() - 1;
+        s.coin_count = 0;
+        if (s.level == 2)
+            s.timer = 30;
+        else if (s.level == 3)
+            s.timer = 45;
+        else if (s.level == 4) {
+            s.over = true;
+            return;
+        }
+        seedLevel(s);
+    }
+    pickUpCoin(s);
+    applyFireDamage(s, dt);
+    if (s.coin_level != s.level)
+        placeCoins(s);
+
+    s.reshuffle_time += dt;
+    if (s.reshuffle_time >= RESHUFFLE_PERIOD) {
+        reshuffle(s);
+        s.reshuffle_time -= RESHUFFLE_PERIOD;
+    }
+    s.timer_time += dt;
+    if (s.timer_time >= 1) {
+        s.timer -= 1;
+        s.timer_time -= 1;
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef GAMESTATE_H
+#define GAMESTATE_H
+
+#include <vector>
+
+#include "board.h"
+#include "rng.h"
+
+/* Everything the game simulates, with no dependency on OpenGL or GLFW so */
+/* it can be stepped headless (tests, balancing, validation). */
+
+/* Directions the player faces and moves in */
+enum Direction {
+    DIR_NONE = 0,
+    DIR_UP = 1, // -z
+    DIR_LEFT = 2, // -x
+    DIR_RIGHT = 3, // +x
+    DIR_DOWN = 4 // +z
+};
+
+/* Coins and fires on a level, fewer on tiny boards; holes and moving */
+/* tiles come at this many per 100 cells, so large boards are as */
+/* dangerous as the default one */
+const int OBSTACLES = 5;
+
+/* Default board size */
+const int BOARD_WIDTH = 10;
+const int BOARD_HEIGHT = 10;
+
+/* What the player asked for since the previous step */
+struct GameInputs {
+    int face; // Direction to turn to, DIR_NONE to keep the current one
+    int move; // Direction to step one cell in, DIR_NONE to stay
+    bool jump; // Start a jump in the facing direction
+    int boost; // +1 or -1 to change the boost, 0 to keep it
+
+    GameInputs()
+        : face(DIR_NONE)
+        , move(DIR_NONE)
+        , jump(false)
+        , boost(0)
+    {
+    }
+};
+
+struct GameState {
+    // Player : cell, offset along the jump arc and facing direction
+    int px, pz;
+    float rx, ry;
+    int dir;
+    bool jump;
+    float ttime; // Time along the jump arc
+    bool on_tile; // Standing on a moving tile
+
+    // Obstacles as board cell indices, -1 when not on the board (a coin once
+    // picked up); each kind is mirrored in its plane of the board
+    Board board;
+    std::vector<int> holes, tiles, fires, coins;
+    float cy; // Height of the moving tiles
+    int b_m; // 0 while the moving tiles go up, 1 while they go down
+
+    float health;
+    int lives;
+    int level;
+    int score;
+    int timer; // Seconds left in the level
+    int coin_count; // Coins picked up this level
+    int iteration; // Boost level
+    int c_i; // Boost cells still to travel
+
+    bool over; // Out of lives or time, or every level cleared
+
+    // Time accumulated towards the next obstacle reshuffle and timer tick
+    double reshuffle_time, timer_time;
+    int coin_level; // Level the coins were placed for
+
+    // Every random placement draws from rng, which is reseeded from seed at
+    // the start of each level, so a seed and the inputs fix the whole game
+    uint64_t seed;
+    Rng rng;
+};
+
+/* Put a fresh game in state on a width x height board (at most MAX_BOARD_SIZE */
+/* a side) : level 1, full lives and health, player on the start cell */
+void resetGame(GameState& state, int width = BOARD_WIDTH, int height = BOARD_HEIGHT, uint64_t seed = 0);
+
+/* Advance the game by dt seconds; the game is tuned for steps of 1/60 s */
+void step(GameState& state, const GameInputs& inputs, double dt);
+
+/* The stages of step(), in the order it runs them after the inputs; they are */
+/* public so each can be measured on its own (microbench.cpp) */
+void stepBoost(GameState& state); // Boosted travel, one cell per step
+void stepMovingTiles(GameState& state, double dt); // Moving tiles go up and down (level 3)
+void stepJump(GameState& state, double dt); // Jump arc and landing
+void checkFall(GameState& state); // Off the board, in a hole or out of health costs a life
+void checkMovingTiles(GameState& state); // Bumping into, landing on and standing on moving tiles
+void pickUpCoin(GameState& state); // Coin under the player
+void applyFireDamage(GameState& state, double dt); // Fire under the player
+void reshuffle(GameState& state); // Move the holes, the fires and (on level 3) the moving tiles
+
+#endif
@@ -0,0 +1,149 @@
+#include "globjects.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Merge identical vertices; vertices receives each distinct one in order of */
+/* first use and indices one entry per input vertex */
+template <typename Vertex>
+static void indexVertices(const vector<Vertex>& input, vector<Vertex>& vertices, vector<GLushort>& indices)
+{
+    map<string, GLushort> seen;
+    for (size_t i = 0; i < input.size(); i++) {
+        string key((const char*)&input[i], sizeof(Vertex));
+        map<string, GLushort>::iterator it = seen.find(key);
+        if (it == seen.end()) {
+            it = seen.insert(make_pair(key, (GLushort)vertices.size())).first;
+            vertices.push_back(input[i]);
+        }
+        indices.push_back(it->second);
+    }
+}
+
+/* Upload the deduplicated vertices and indices into a fresh VAO, the */
+/* caller sets up the vertex attributes while the VAO is still bound */
+template <typename Vertex>
+static struct VAO* createIndexedObject(GLenum primitive_mode, const vector<Vertex>& vertices, const vector<GLushort>& indices, GLenum fill_mode)
+{
+    struct VAO* vao = new struct VAO;
+    vao->PrimitiveMode = primitive_mode;
+    vao->NumVertices = (int)vertices.size();
+    vao->NumIndices = (int)indices.size();
+    vao->FillMode = fill_mode;
+
+    // Create Vertex Array Object
+    // Should be done after CreateWindow and before any other GL calls
+    vao->VertexArray.create(); // VAO
+    vao->VertexBuffer.create(); // VBO - interleaved vertices
+    vao->IndexBuffer.create(); // IBO - indices
+
+    glBindVertexArray(vao->VertexArray.id()); // Bind the VAO
+    vao->VertexBuffer.upload(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW); // Copy the vertices into VBO
+    vao->IndexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW); // The VAO remembers the index buffer
+
+    return vao;
+}
+
+void buildColorMesh(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, MeshData& mesh, GLenum fill_mode)
+{
+    vector<ColorVertex> input(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        for (int k = 0; k < 3; k++) {
+            input[i].position[k] = vertex_buffer_data[3 * i + k];
+            float c = min(max(color_buffer_data[3 * i + k], 0.f), 1.f);
+            input[i].color[k] = (GLubyte)(c * 255.f + 0.5f);
+        }
+        input[i].color[3] = 255;
+    }
+
+    mesh.PrimitiveMode = primitive_mode;
+    mesh.FillMode = fill_mode;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    indexVertices(input, mesh.vertices, mesh.indices);
+}
+
+struct VAO* uploadColorMesh(const MeshData& mesh)
+{
+    struct VAO* vao = createIndexedObject(mesh.PrimitiveMode, mesh.vertices, mesh.indices, mesh.FillMode);
+    glVertexAttribPointer(
+        0, // attribute 0. Vertices
+        3, // size (x,y,z)
+        GL_FLOAT, // type
+        GL_FALSE, // normalized?
+        sizeof(ColorVertex), // stride
+        (void*)offsetof(ColorVertex, position) // array buffer offset
+        );
+    glEnableVertexAttribArray(0); // Enabled once, the VAO remembers it
+
+    glVertexAttribPointer(
+        1, // attribute 1. Color
+        3, // size (r,g,b)
+        GL_UNSIGNED_BYTE, // type
+        GL_TRUE, // normalized?
+        sizeof(ColorVertex), // stride
+        (void*)offsetof(ColorVertex, color) // array buffer offset
+        );
+    glEnableVertexAttribArray(1); // Enabled once, the VAO remembers it
+
+    return vao;
+}
+
+/* Generate VAO, VBOs and return VAO handle */
+struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode)
+{
+    MeshData mesh;
+    buildColorMesh(primitive_mode, numVertices, vertex_buffer_data, color_buffer_data, mesh, fill_mode);
+    return uploadColorMesh(mesh);
+}
+
+/* Generate VAO, VBOs and return VAO handle - Common Color for all vertices */
+struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode)
+{
+    std::vector<GLfloat> color_buffer_data(3 * numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        color_buffer_data[3 * i] = red;
+        color_buffer_data[3 * i + 1] = green;
+        color_buffer_data[3 * i + 2] = blue;
+    }
+
+    return create3DObject(primitive_mode, numVertices, vertex_buffer_data, &color_buffer_data[0], fill_mode);
+}
+
+/* Add a per-instance attribute buffer to an existing VAO */
+/* Each instance is a vec4 : x offset, z offset, moving-tile flag, hole flag */
+/* Calling it again replaces the buffer with one of the new size */
+void addInstanceBuffer(struct VAO* vao, int numInstances)
+{
+    vao->NumInstances = numInstances;
+
+    vao->InstanceBuffer.create(); // VBO - instances
+
+    glBindVertexArray(vao->VertexArray.id()); // Bind the VAO
+    vao->InstanceBuffer.upload(GL_ARRAY_BUFFER, 4 * numInstances * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW); // Filled in by streamInstanceBuffer
+    glVertexAttribPointer(
+        3, // attribute 3. Instance data
+        4, // size (x,z,moving,hole)
+        GL_FLOAT, // type
+        GL_FALSE, // normalized?
+        0, // stride
+        (void*)0 // array buffer offset
+        );
+    glEnableVertexAttribArray(3); // Enabled once, the VAO remembers it
+    glVertexAttribDivisor(3, 1); // Advance once per instance instead of once per vertex
+}
+
+/* Replace the instances drawn from the VAO with the first count of data, */
+/* orphaning the old storage so the driver never waits on the last frame's draw */
+void streamInstanceBuffer(struct VAO* vao, const GLfloat* instance_buffer_data, int count)
+{
+    vao->NumInstances = count;
+    glBindBuffer(GL_ARRAY_BUFFER, vao->InstanceBuffer.id());
+    glBufferData(GL_ARRAY_BUFFER, vao->InstanceBuffer.bytes(), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, 4 * count * sizeof(GLfloat), instance_buffer_data);
+}
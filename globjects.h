@@ -0,0 +1,64 @@
+#ifndef GLOBJECTS_H
+#define GLOBJECTS_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glresource.h"
+
+/* Interleaved vertex of a colored mesh, 16 bytes */
+struct ColorVertex {
+    GLfloat position[3];
+    GLubyte color[4]; // Normalized to 0..1 by the vertex fetch
+};
+
+struct VAO {
+    GLVertexArray VertexArray;
+    GLBuffer VertexBuffer; // Interleaved vertices
+    GLBuffer IndexBuffer; // Unsigned short indices, empty for non-indexed meshes
+    GLBuffer InstanceBuffer;
+    GLuint TextureID; // Not owned, textures live in the resource cache
+
+    GLenum PrimitiveMode; // GL_POINTS, GL_LINE_STRIP, GL_LINE_LOOP, GL_LINES, GL_LINE_STRIP_ADJACENCY, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES, GL_TRIANGLE_STRIP_ADJACENCY and GL_TRIANGLES_ADJACENCY
+    GLenum FillMode; // GL_FILL, GL_LINE
+    int NumVertices;
+    int NumIndices; // Drawn with glDrawElements when non zero
+    int NumInstances;
+
+    VAO()
+        : TextureID(0)
+        , PrimitiveMode(GL_TRIANGLES)
+        , FillMode(GL_FILL)
+        , NumVertices(0)
+        , NumIndices(0)
+        , NumInstances(0)
+    {
+    }
+};
+typedef struct VAO VAO;
+
+/* A colored mesh with its identical vertices merged, built without */
+/* touching GL so it can be prepared on another thread */
+struct MeshData {
+    GLenum PrimitiveMode;
+    GLenum FillMode;
+    std::vector<ColorVertex> vertices;
+    std::vector<GLushort> indices;
+};
+
+/* Generate VAO, VBOs and return VAO handle */
+/* The triangles are given unindexed; identical vertices are merged into one */
+/* interleaved vertex buffer plus an index buffer */
+struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode = GL_FILL);
+struct VAO* create3DObject(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode = GL_FILL);
+
+/* The two halves of create3DObject : merging the vertices into mesh, which */
+/* touches no GL, then uploading the result into a fresh VAO */
+void buildColorMesh(GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, MeshData& mesh, GLenum fill_mode = GL_FILL);
+struct VAO* uploadColorMesh(const MeshData& mesh);
+
+void addInstanceBuffer(struct VAO* vao, int numInstances);
+void streamInstanceBuffer(struct VAO* vao, const GLfloat* instance_buffer_data, int count);
+
+#endif
@@ -0,0 +1,83 @@
+#include "glresource.h"
+
+#include <iomanip>
+
+namespace {
+
+struct Counter {
+    int live;
+    int peak;
+    size_t bytes;
+    size_t peakBytes;
+};
+
+Counter counters[GPU_RESOURCE_TYPES];
+
+const char* typeNames[GPU_RESOURCE_TYPES] = {
+    "vertex arrays",
+    "buffers",
+    "textures",
+    "programs",
+    "queries",
+    "framebuffers",
+    "renderbuffers"
+};
+
+}
+
+namespace GpuRegistry {
+
+void add(GpuResourceType type)
+{
+    Counter& c = counters[type];
+    c.live++;
+    if (c.live > c.peak)
+        c.peak = c.live;
+}
+
+void remove(GpuResourceType type, size_t bytes)
+{
+    Counter& c = counters[type];
+    c.live--;
+    c.bytes -= bytes;
+}
+
+void resize(GpuResourceType type, size_t old_bytes, size_t new_bytes)
+{
+    Counter& c = counters[type];
+    c.bytes = c.bytes - old_bytes + new_bytes;
+    if (c.bytes > c.peakBytes)
+        c.peakBytes = c.bytes;
+}
+
+int live(GpuResourceType type)
+{
+    return counters[type].live;
+}
+
+size_t bytes(GpuResourceType type)
+{
+    return counters[type].bytes;
+}
+
+void report(std::ostream& out)
+{
+    int total_live = 0;
+    size_t total_bytes = 0;
+    out << "GPU objects        live   peak        bytes   peak bytes" << std::endl;
+    for (int i = 0; i < GPU_RESOURCE_TYPES; i++) {
+        const Counter& c = counters[i];
+        out << "  " << std::left << std::setw(14) << typeNames[i] << std::right
+            << std::setw(8) << c.live
+            << std::setw(7) << c.peak
+            << std::setw(13) << c.bytes
+            << std::setw(13) << c.peakBytes << std::endl;
+        total_live += c.live;
+        total_bytes += c.bytes;
+    }
+    out << "  " << std::left << std::setw(14) << "total" << std::right
+        << std::setw(8) << total_live
+        << std::setw(20) << total_bytes << std::endl;
+}
+
+}
@@ -0,0 +1,175 @@
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+#include <cstddef>
+#include <ostream>
+
+#include <glad/glad.h>
+
+/* Kinds of GPU objects tracked by the registry */
+enum GpuResourceType {
+    GPU_VERTEX_ARRAY,
+    GPU_BUFFER,
+    GPU_TEXTURE,
+    GPU_PROGRAM,
+    GPU_QUERY,
+    GPU_FRAMEBUFFER,
+    GPU_RENDERBUFFER,
+    GPU_RESOURCE_TYPES
+};
+
+/* Live-object registry : how many GPU objects of each type exist right */
+/* now, the most that ever existed at once and how many bytes they hold */
+namespace GpuRegistry {
+void add(GpuResourceType type);
+void remove(GpuResourceType type, size_t bytes);
+void resize(GpuResourceType type, size_t old_bytes, size_t new_bytes);
+int live(GpuResourceType type);
+size_t bytes(GpuResourceType type);
+void report(std::ostream& out);
+}
+
+/* How each type of object is generated and deleted */
+template <GpuResourceType Type>
+struct GpuObjectTraits;
+
+template <>
+struct GpuObjectTraits<GPU_VERTEX_ARRAY> {
+    static GLuint create() { GLuint id; glGenVertexArrays(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_BUFFER> {
+    static GLuint create() { GLuint id; glGenBuffers(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_TEXTURE> {
+    static GLuint create() { GLuint id; glGenTextures(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_PROGRAM> {
+    static GLuint create() { return glCreateProgram(); }
+    static void destroy(GLuint id) { glDeleteProgram(id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_QUERY> {
+    static GLuint create() { GLuint id; glGenQueries(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteQueries(1, &id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_FRAMEBUFFER> {
+    static GLuint create() { GLuint id; glGenFramebuffers(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+
+template <>
+struct GpuObjectTraits<GPU_RENDERBUFFER> {
+    static GLuint create() { GLuint id; glGenRenderbuffers(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteRenderbuffers(1, &id); }
+};
+
+/* Move-only owner of one GPU object; the object is deleted with its owner */
+template <GpuResourceType Type>
+class GpuObject {
+public:
+    GpuObject() : name(0), size(0) {}
+    ~GpuObject() { reset(); }
+
+    GpuObject(GpuObject&& other) : name(other.name), size(other.size)
+    {
+        other.name = 0;
+        other.size = 0;
+    }
+
+    GpuObject& operator=(GpuObject&& other)
+    {
+        if (this != &other) {
+            reset();
+            name = other.name;
+            size = other.size;
+            other.name = 0;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    GpuObject(const GpuObject&) = delete;
+    GpuObject& operator=(const GpuObject&) = delete;
+
+    /* Generate a fresh object, deleting the one held before */
+    void create()
+    {
+        reset();
+        name = GpuObjectTraits<Type>::create();
+        GpuRegistry::add(Type);
+    }
+
+    /* Take ownership of an object generated elsewhere */
+    void adopt(GLuint id)
+    {
+        reset();
+        name = id;
+        if (name)
+            GpuRegistry::add(Type);
+    }
+
+    void reset()
+    {
+        if (!name)
+            return;
+        GpuObjectTraits<Type>::destroy(name);
+        GpuRegistry::remove(Type, size);
+        name = 0;
+        size = 0;
+    }
+
+    /* Record how much GPU memory the object's storage takes */
+    void setBytes(size_t bytes)
+    {
+        GpuRegistry::resize(Type, size, bytes);
+        size = bytes;
+    }
+
+    GLuint id() const { return name; }
+    size_t bytes() const { return size; }
+
+private:
+    GLuint name;
+    size_t size;
+};
+
+typedef GpuObject<GPU_VERTEX_ARRAY> GLVertexArray;
+typedef GpuObject<GPU_TEXTURE> GLTexture;
+typedef GpuObject<GPU_PROGRAM> GLProgram;
+typedef GpuObject<GPU_QUERY> GLQuery;
+typedef GpuObject<GPU_FRAMEBUFFER> GLFramebuffer;
+typedef GpuObject<GPU_RENDERBUFFER> GLRenderbuffer;
+
+/* Buffers also know how to fill their storage so the byte count stays right */
+class GLBuffer : public GpuObject<GPU_BUFFER> {
+public:
+    GLBuffer() {}
+    GLBuffer(GLBuffer&& other) : GpuObject<GPU_BUFFER>(static_cast<GpuObject<GPU_BUFFER>&&>(other)) {}
+    GLBuffer& operator=(GLBuffer&& other)
+    {
+        GpuObject<GPU_BUFFER>::operator=(static_cast<GpuObject<GPU_BUFFER>&&>(other));
+        return *this;
+    }
+
+    /* Bind to target and (re)allocate the storage with glBufferData */
+    void upload(GLenum target, size_t bytes, const void* data, GLenum usage)
+    {
+        glBindBuffer(target, id());
+        glBufferData(target, bytes, data, usage);
+        setBytes(bytes);
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "gputimer.h"
+
+GpuTimer::GpuTimer(int depth)
+    : slots(depth)
+    , head(0)
+    , oldest(0)
+{
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].pending = false;
+}
+
+void GpuTimer::begin(int tag)
+{
+    Slot& slot = slots[head];
+    // Every query is in flight, wait for them rather than lose one
+    if (slot.pending)
+        retire(true);
+    if (!slot.query.id())
+        slot.query.create();
+    slot.tag = tag;
+    glBeginQuery(GL_TIME_ELAPSED, slot.query.id());
+}
+
+void GpuTimer::end()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    slots[head].pending = true;
+    head = (head + 1) % slots.size();
+}
+
+void GpuTimer::collect(std::vector<GpuSample>& out, bool wait)
+{
+    retire(wait);
+    out.insert(out.end(), finished.begin(), finished.end());
+    finished.clear();
+}
+
+void GpuTimer::retire(bool wait)
+{
+    while (slots[oldest].pending) {
+        Slot& slot = slots[oldest];
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(slot.query.id(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(slot.query.id(), GL_QUERY_RESULT, &ns);
+        GpuSample sample = { slot.tag, ns / 1e6 };
+        finished.push_back(sample);
+        slot.pending = false;
+        oldest = (oldest + 1) % slots.size();
+    }
+}
+
+void GpuTimer::release()
+{
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i].query.reset();
+        slots[i].pending = false;
+    }
+    finished.clear();
+    head = oldest = 0;
+}
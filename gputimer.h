@@ -0,0 +1,49 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <vector>
+
+#include "glresource.h"
+
+/* One finished GPU measurement and the tag it was started with */
+struct GpuSample {
+    int tag;
+    double ms;
+};
+
+/* GPU time of spans of GL commands, measured with GL_TIME_ELAPSED queries. */
+/* Results come back a few frames late; a ring of queries keeps several in */
+/* flight so reading them never stalls the pipeline */
+class GpuTimer {
+public:
+    explicit GpuTimer(int depth = 8);
+
+    /* Only one span can be open at a time, timer queries do not nest */
+    void begin(int tag);
+    void end();
+
+    /* Append the finished measurements to out, oldest first; with wait, */
+    /* block until every span that was ended has its result */
+    void collect(std::vector<GpuSample>& out, bool wait = false);
+
+    /* Delete the queries, dropping any result not collected yet; must run */
+    /* while the GL context is still current */
+    void release();
+
+private:
+    struct Slot {
+        GLQuery query;
+        int tag;
+        bool pending;
+    };
+
+    /* Read back the results that are ready, or all of them with wait */
+    void retire(bool wait);
+
+    std::vector<Slot> slots;
+    std::vector<GpuSample> finished; // Read back but not collected yet
+    int head; // Slot the next span goes in
+    int oldest; // Oldest slot still waiting for its result
+};
+
+#endif
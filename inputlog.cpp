@@ -0,0 +1,217 @@
+#include "inputlog.h"
+
+#include <cstring>
+
+static const char MAGIC[4] = { 'G', 'R', 'V', 'L' };
+static const uint64_t VERSION = 1;
+
+/* Signed values are zigzag encoded so small negatives stay one byte */
+static uint64_t zigzag(int value)
+{
+    return value < 0 ? 2 * (uint64_t)(-(int64_t)value) - 1 : 2 * (uint64_t)value;
+}
+
+static int unzigzag(uint64_t value)
+{
+    return value & 1 ? -(int)((value + 1) / 2) : (int)(value / 2);
+}
+
+/* Inputs of a step in a few bits : face, move, jump, then the boost */
+static uint64_t pack(const GameInputs& in)
+{
+    return (uint64_t)in.face | (uint64_t)in.move << 3 | (uint64_t)in.jump << 6 | zigzag(in.boost) << 7;
+}
+
+static GameInputs unpack(uint64_t packed)
+{
+    GameInputs in;
+    in.face = packed & 7;
+    in.move = (packed >> 3) & 7;
+    in.jump = (packed >> 6) & 1;
+    in.boost = unzigzag(packed >> 7);
+    return in;
+}
+
+bool InputRecorder::open(const char* file, const GameState& state)
+{
+    if (out.is_open())
+        out.close();
+    out.open(file, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(MAGIC, sizeof(MAGIC));
+    writeVarint(VERSION);
+    writeVarint(state.seed);
+    writeVarint(state.board.width());
+    writeVarint(state.board.height());
+    steps = 0;
+    return true;
+}
+
+void InputRecorder::record(const GameInputs& inputs)
+{
+    steps++;
+    uint64_t packed = pack(inputs);
+    if (packed == 0)
+        return;
+    writeVarint(steps);
+    writeVarint(packed);
+    steps = 0;
+}
+
+void InputRecorder::close(const GameState& state)
+{
+    if (!out.is_open())
+        return;
+    writeVarint(steps);
+    writeVarint(0);
+    writeVarint(zigzag(state.score));
+    out.close();
+}
+
+void InputRecorder::writeVarint(uint64_t value)
+{
+    // Seven bits per byte, low bits first, the top bit set on all but the last
+    char bytes[10];
+    int n = 0;
+    do {
+        bytes[n] = value & 0x7f;
+        value >>= 7;
+        if (value)
+            bytes[n] |= 0x80;
+        n++;
+    } while (value);
+    out.write(bytes, n);
+}
+
+InputLog::InputLog()
+    : data(NULL)
+    , size(0)
+    , events(0)
+    , pos(0)
+    , gameSeed(0)
+    , boardWidth(0)
+    , boardHeight(0)
+    , wait(0)
+    , pendingEnd(false)
+    , hasEnd(false)
+    , endScore(0)
+    , done(true)
+{
+}
+
+InputLog::~InputLog()
+{
+    close();
+}
+
+bool InputLog::open(const char* file)
+{
+    close();
+    if (!mapping.open(file))
+        return false;
+    data = mapping.data();
+    size = mapping.size();
+
+    uint64_t version, seed, width, height;
+    pos = sizeof(MAGIC);
+    if (size < sizeof(MAGIC) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || !readVarint(version) || version != VERSION
+        || !readVarint(seed) || !readVarint(width) || !readVarint(height)) {
+        close();
+        return false;
+    }
+    gameSeed = seed;
+    boardWidth = (int)width;
+    boardHeight = (int)height;
+    events = pos;
+
+    // Walk the events once to find out whether the game was logged to its end
+    while (readEvent())
+        if (pendingEnd) {
+            hasEnd = true;
+            break;
+        }
+    pos = events;
+    done = true;
+    return true;
+}
+
+void InputLog::close()
+{
+    mapping.close();
+    data = NULL;
+    size = 0;
+    hasEnd = false;
+    done = true;
+}
+
+void InputLog::restart(GameState& state)
+{
+    resetGame(state, boardWidth, boardHeight, gameSeed);
+    pos = events;
+    done = !readEvent();
+}
+
+bool InputLog::next(GameInputs& inputs)
+{
+    if (done)
+        return false;
+    inputs = GameInputs();
+    if (pendingEnd) {
+        // The end marker counts the empty steps after the last input
+        if (wait == 0) {
+            done = true;
+            return false;
+        }
+        wait--;
+        return true;
+    }
+    if (--wait > 0)
+        return true;
+    inputs = pending;
+    done = !readEvent();
+    return true;
+}
+
+bool InputLog::readVarint(uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+        unsigned char byte = data[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool InputLog::readEvent()
+{
+    uint64_t steps, packed;
+    // Only the end marker can come on the same step as the previous event
+    if (!readVarint(steps) || !readVarint(packed) || (steps == 0 && packed != 0))
+        return false;
+    wait = (long)steps;
+    pendingEnd = packed == 0;
+    if (pendingEnd) {
+        uint64_t score;
+        if (!readVarint(score))
+            return false;
+        endScore = unzigzag(score);
+    }
+    else
+        pending = unpack(packed);
+    return true;
+}
+
+long replayGame(InputLog& log, GameState& state, double dt)
+{
+    log.restart(state);
+    long steps = 0;
+    GameInputs inputs;
+    while (!state.over && log.next(inputs)) {
+        step(state, inputs, dt);
+        steps++;
+    }
+    return steps;
+}
@@ -0,0 +1,86 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <fstream>
+#include <stdint.h>
+
+#include "gamestate.h"
+#include "mappedfile.h"
+
+/* Recorded games. A game is fixed by its board size, its seed and the inputs */
+/* of every simulation step, so that is all a log holds. The file is a header */
+/* then one event per step that had any input, everything varint encoded : */
+/*   "GRVL" version seed width height */
+/*   { steps since the previous event, packed inputs (never 0) }* */
+/*   steps since the previous event, 0, final score */
+/* The step count is the timestamp, one step being the fixed SIM_DT. */
+
+/* Writes the inputs of one game to a file as it is played */
+class InputRecorder {
+public:
+    /* Start a log for the game just reset in state, replacing file */
+    bool open(const char* file, const GameState& state);
+    bool isOpen() const { return out.is_open(); }
+
+    /* Inputs the game was stepped with, once per step */
+    void record(const GameInputs& inputs);
+
+    /* End the log with the game's final state */
+    void close(const GameState& state);
+
+private:
+    void writeVarint(uint64_t value);
+
+    std::ofstream out;
+    long steps; // Steps since the last event written
+};
+
+/* A log mapped into memory, read back one step at a time */
+class InputLog {
+public:
+    InputLog();
+    ~InputLog();
+
+    bool open(const char* file);
+    void close();
+
+    uint64_t seed() const { return gameSeed; }
+    int width() const { return boardWidth; }
+    int height() const { return boardHeight; }
+
+    /* Reset state to the logged game and start again from its first step */
+    void restart(GameState& state);
+
+    /* Inputs of the next step; false once every logged step has been read */
+    bool next(GameInputs& inputs);
+
+    /* Whether the log was complete, and the score the game finished with */
+    bool finished() const { return hasEnd; }
+    int finalScore() const { return endScore; }
+
+private:
+    bool readVarint(uint64_t& value);
+    bool readEvent();
+
+    MappedFile mapping;
+    const unsigned char* data; // The mapping's bytes
+    size_t size;
+    size_t events; // Offset of the first event
+    size_t pos;
+
+    uint64_t gameSeed;
+    int boardWidth, boardHeight;
+
+    long wait; // Steps left before the pending event
+    GameInputs pending;
+    bool pendingEnd; // The pending event is the end of the game
+    bool hasEnd;
+    int endScore;
+    bool done;
+};
+
+/* Step state through a whole log as fast as possible, from a fresh game; */
+/* returns the number of steps taken */
+long replayGame(InputLog& log, GameState& state, double dt);
+
+#endif
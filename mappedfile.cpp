@@ -0,0 +1,43 @@
+#include "mappedfile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+    : bytes(NULL)
+    , length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* file)
+{
+    close();
+    int fd = ::open(file, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            bytes = (const unsigned char*)mapping;
+            length = st.st_size;
+        }
+    }
+    ::close(fd);
+    return bytes != NULL;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap((void*)bytes, length);
+    bytes = NULL;
+    length = 0;
+}
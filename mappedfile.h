@@ -0,0 +1,28 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+/* A whole file mapped read-only, what the .pak, .gatlas and input log */
+/* readers parse in place instead of reading the file */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /* False if the file is missing, empty or could not be mapped */
+    bool open(const char* file);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const unsigned char* bytes;
+    size_t length;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/* Microbenchmarks of the simulation : each stage of step() timed on its own, */
+/* on the default board and on the largest one, printed as JSON. */
+/* Usage : ./microbench [SECONDS per kernel and board, default 0.2] */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "gamestate.h"
+
+using namespace std;
+
+static const double DT = 1.0 / 60.0;
+static const int REPEATS = 5; // Timed runs per kernel, the median is reported
+static const int BATCH = 1024; // Most calls between clock reads, fewer for slow kernels
+
+/* One kernel : set up puts a fresh game in the shape the kernel needs, run */
+/* calls it once and undoes whatever would stop the next call doing the same work */
+struct Kernel {
+    const char* name;
+    void (*setUp)(GameState&);
+    void (*run)(GameState&);
+};
+
+static int middleCell(const GameState& s)
+{
+    return s.board.cell(s.board.width() / 2, s.board.height() / 2);
+}
+
+/* Put the player on the middle cell with nothing under it */
+static void centrePlayer(GameState& s)
+{
+    s.px = s.board.width() / 2;
+    s.pz = s.board.height() / 2;
+    for (int plane = 0; plane < CELL_PLANES; plane++)
+        s.board.clear(middleCell(s), (CellPlane)plane);
+}
+
+static void setUpJump(GameState& s)
+{
+    centrePlayer(s);
+    s.dir = DIR_RIGHT;
+}
+
+static void runJump(GameState& s)
+{
+    if (!s.jump) {
+        s.jump = true;
+        s.px = s.board.width() / 2;
+    }
+    stepJump(s, DT);
+}
+
+static void setUpMovingTiles(GameState& s)
+{
+    s.level = 3;
+    centrePlayer(s);
+    s.dir = DIR_UP;
+    s.board.set(middleCell(s), CELL_MOVING);
+    s.board.set(s.board.cell(s.px, s.pz - 1), CELL_MOVING);
+}
+
+static void runMovingTiles(GameState& s)
+{
+    stepMovingTiles(s, DT);
+    checkMovingTiles(s);
+    // Stay on the tile and keep the health from running out
+    s.px = s.board.width() / 2;
+    s.pz = s.board.height() / 2;
+    s.health = 15;
+}
+
+static void setUpFall(GameState& s)
+{
+    centrePlayer(s);
+    s.board.set(middleCell(s), CELL_HOLE);
+}
+
+static void runFall(GameState& s)
+{
+    // Fall into the hole every time
+    s.px = s.board.width() / 2;
+    s.pz = s.board.height() / 2;
+    s.lives = 3;
+    checkFall(s);
+}
+
+static void setUpFire(GameState& s)
+{
+    s.level = 2;
+    centrePlayer(s);
+    s.board.set(middleCell(s), CELL_FIRE);
+}
+
+static void runFire(GameState& s)
+{
+    applyFireDamage(s, DT);
+    s.health = 15;
+}
+
+static void setUpCoin(GameState& s)
+{
+    centrePlayer(s);
+}
+
+static void runCoin(GameState& s)
+{
+    // Drop the first coin back under the player
+    s.board.clear(s.coins[0], CELL_COIN);
+    s.coins[0] = middleCell(s);
+    s.board.set(s.coins[0], CELL_COIN);
+    pickUpCoin(s);
+}
+
+static void setUpReshuffle(GameState& s)
+{
+    s.level = 3;
+}
+
+static void runReshuffle(GameState& s)
+{
+    reshuffle(s);
+}
+
+static void setUpStep(GameState& s)
+{
+    s.level = 3;
+    centrePlayer(s);
+}
+
+static void runStep(GameState& s)
+{
+    step(s, GameInputs(), DT);
+    if (s.over)
+        setUpStep(s);
+    s.lives = 3;
+    s.timer = 45;
+}
+
+static const Kernel KERNELS[] = {
+    { "jump", setUpJump, runJump },
+    { "moving_tiles", setUpMovingTiles, runMovingTiles },
+    { "fall", setUpFall, runFall },
+    { "fire_damage", setUpFire, runFire },
+    { "coin_pickup", setUpCoin, runCoin },
+    { "reshuffle", setUpReshuffle, runReshuffle },
+    { "step", setUpStep, runStep },
+};
+
+static double now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 0.2;
+    if (seconds <= 0) {
+        cerr << "usage : " << argv[0] << " [SECONDS per kernel and board]" << endl;
+        return EXIT_FAILURE;
+    }
+    // The default board, and the largest one for stress-scale obstacle counts
+    const int sizes[] = { BOARD_WIDTH, MAX_BOARD_SIZE };
+
+    cout << "{\n  \"seconds\": " << seconds << ",\n  \"kernels\": [\n";
+    bool first = true;
+    for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+        for (int b = 0; b < 2; b++) {
+            const Kernel& kernel = KERNELS[k];
+            GameState s;
+            resetGame(s, sizes[b], sizes[b], 1);
+            kernel.setUp(s);
+
+            vector<double> ns;
+            long calls = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                long n = 0;
+                int batch = 1;
+                double start = now(), elapsed;
+                do {
+                    for (int i = 0; i < batch; i++)
+                        kernel.run(s);
+                    n += batch;
+                    batch = min(2 * batch, BATCH);
+                    elapsed = now() - start;
+                } while (elapsed < seconds / REPEATS);
+                ns.push_back(elapsed * 1e9 / n);
+                calls += n;
+            }
+            sort(ns.begin(), ns.end());
+
+            cout << (first ? "" : ",\n") << "    {\"name\": \"" << kernel.name << "\", \"board\": \"" << sizes[b] << "x" << sizes[b]
+                 << "\", \"holes\": " << s.holes.size() << ", \"moving_tiles\": " << s.tiles.size() << ", \"calls\": " << calls
+                 << ", \"ns_per_call_median\": " << ns[REPEATS / 2] << ", \"ns_per_call_min\": " << ns[0] << "}";
+            first = false;
+        }
+    }
+    cout << "\n  ]\n}" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+/* Asset packer : bundles the game's assets into one .pak the game maps at */
+/* startup. Each file is stored under its name without the directory. */
+/* Usage : ./mkpak OUTPUT.pak FILE... */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pak.h"
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        cerr << "usage : " << argv[0] << " OUTPUT.pak FILE..." << endl;
+        return EXIT_FAILURE;
+    }
+    vector<string> inputs(argv + 2, argv + argc);
+    if (!writePak(argv[1], inputs))
+        return EXIT_FAILURE;
+    cout << inputs.size() << " assets -> " << argv[1] << endl;
+    return EXIT_SUCCESS;
+}
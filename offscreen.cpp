@@ -0,0 +1,114 @@
+#include "offscreen.h"
+
+#include <EGL/eglext.h>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+OffscreenTarget::OffscreenTarget()
+    : display(EGL_NO_DISPLAY)
+    , context(EGL_NO_CONTEXT)
+    , w(0)
+    , h(0)
+{
+}
+
+bool OffscreenTarget::create(int width, int height)
+{
+    w = width;
+    h = height;
+
+    // Ask for Mesa's surfaceless platform, which needs no X, Wayland or GPU
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        cout << "Offscreen : no EGL display (error 0x" << hex << eglGetError() << dec << ")" << endl;
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    eglChooseConfig(display, config_attributes, &config, 1, &configs);
+    // Same context as the window gets : 3.3 core
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, configs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        cout << "Offscreen : could not create a surfaceless OpenGL 3.3 context (error 0x" << hex << eglGetError() << dec << ")" << endl;
+        release();
+        return false;
+    }
+    gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+
+    // There is no default framebuffer, everything is drawn into this one
+    color.create();
+    glBindRenderbuffer(GL_RENDERBUFFER, color.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    color.setBytes((size_t)w * h * 4);
+    depth.create();
+    glBindRenderbuffer(GL_RENDERBUFFER, depth.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+    depth.setBytes((size_t)w * h * 4);
+    framebuffer.create();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth.id());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        cout << "Offscreen : the " << w << "x" << h << " framebuffer is incomplete" << endl;
+        release();
+        return false;
+    }
+    glViewport(0, 0, w, h);
+    return true;
+}
+
+void OffscreenTarget::release()
+{
+    if (context != EGL_NO_CONTEXT) {
+        framebuffer.reset();
+        color.reset();
+        depth.reset();
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    if (display != EGL_NO_DISPLAY) {
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+    }
+}
+
+bool OffscreenTarget::dump(const char* file) const
+{
+    vector<unsigned char> pixels((size_t)w * h * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    FILE* out = fopen(file, "wb");
+    if (!out) {
+        cout << "Offscreen : could not write " << file << endl;
+        return false;
+    }
+    fprintf(out, "P6\n%d %d\n255\n", w, h);
+    // GL rows go bottom to top, PPM rows top to bottom
+    for (int y = h - 1; y >= 0; y--)
+        fwrite(&pixels[(size_t)y * w * 3], 1, (size_t)w * 3, out);
+    fclose(out);
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <EGL/egl.h>
+
+#include "glresource.h"
+
+/* A GL 3.3 core context with no window and no display server : a surfaceless */
+/* EGL context (Mesa, software rasterizer included) whose frames are drawn */
+/* into a framebuffer object of the chosen size */
+class OffscreenTarget {
+public:
+    OffscreenTarget();
+
+    /* Create the context, make it current, load GL and bind the framebuffer; */
+    /* prints what went wrong and returns false on failure */
+    bool create(int width, int height);
+
+    /* Delete the framebuffer and the context */
+    void release();
+
+    int width() const { return w; }
+    int height() const { return h; }
+
+    /* Write what was drawn so far as a binary PPM */
+    bool dump(const char* file) const;
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+    GLFramebuffer framebuffer;
+    GLRenderbuffer color, depth;
+    int w, h;
+};
+
+#endif
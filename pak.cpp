@@ -0,0 +1,153 @@
+#include "pak.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char MAGIC[4] = { 'G', 'P', 'A', 'K' };
+
+PakFile pak;
+
+/* Name of a file without its directory */
+static string baseName(const string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+static bool entryBefore(const PakEntry& a, const PakEntry& b)
+{
+    return strcmp(a.name, b.name) < 0;
+}
+
+bool writePak(const char* file, const vector<string>& inputs)
+{
+    vector<PakEntry> entries(inputs.size());
+    vector<vector<char> > contents(inputs.size());
+    vector<size_t> order(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        string name = baseName(inputs[i]);
+        if (name.empty() || name.size() >= (size_t)PAK_NAME_SIZE) {
+            cerr << "Asset name too long for a pak : " << name << endl;
+            return false;
+        }
+        ifstream in(inputs[i].c_str(), ios::in | ios::binary);
+        if (!in.is_open()) {
+            cerr << "Could not read " << inputs[i] << endl;
+            return false;
+        }
+        contents[i].assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        memset(&entries[i], 0, sizeof(PakEntry));
+        strcpy(entries[i].name, name.c_str());
+        entries[i].size = contents[i].size();
+        order[i] = i;
+    }
+    // Sorted by name so lookups can bisect
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entryBefore(entries[a], entries[b]); });
+    for (size_t i = 1; i < order.size(); i++)
+        if (strcmp(entries[order[i - 1]].name, entries[order[i]].name) == 0) {
+            cerr << "Two assets are called " << entries[order[i]].name << endl;
+            return false;
+        }
+
+    PakHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = PAK_VERSION;
+    header.count = inputs.size();
+    header.reserved = 0;
+    vector<PakEntry> table;
+    uint64_t offset = sizeof(PakHeader) + inputs.size() * sizeof(PakEntry);
+    for (size_t i = 0; i < order.size(); i++) {
+        offset = (offset + PAK_ALIGNMENT - 1) / PAK_ALIGNMENT * PAK_ALIGNMENT;
+        table.push_back(entries[order[i]]);
+        table.back().offset = offset;
+        offset += table.back().size;
+    }
+
+    FILE* out = fopen(file, "wb");
+    if (!out) {
+        cerr << "Could not write " << file << endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+        && (table.empty() || fwrite(&table[0], sizeof(PakEntry), table.size(), out) == table.size());
+    for (size_t i = 0; ok && i < table.size(); i++) {
+        const vector<char>& blob = contents[order[i]];
+        ok = fseek(out, (long)table[i].offset, SEEK_SET) == 0 && (blob.empty() || fwrite(&blob[0], 1, blob.size(), out) == blob.size());
+    }
+    return fclose(out) == 0 && ok;
+}
+
+PakFile::PakFile()
+    : head(NULL)
+    , entries(NULL)
+{
+}
+
+bool PakFile::open(const char* file)
+{
+    close();
+    if (!mapping.open(file) || mapping.size() < sizeof(PakHeader)) {
+        close();
+        return false;
+    }
+
+    const unsigned char* data = mapping.data();
+    size_t size = mapping.size();
+    head = (const PakHeader*)data;
+    entries = (const PakEntry*)(data + sizeof(PakHeader));
+    bool valid = memcmp(head->magic, MAGIC, sizeof(MAGIC)) == 0 && head->version == PAK_VERSION
+        && head->count <= (size - sizeof(PakHeader)) / sizeof(PakEntry);
+    for (uint32_t i = 0; valid && i < head->count; i++) {
+        const PakEntry& entry = entries[i];
+        valid = memchr(entry.name, 0, PAK_NAME_SIZE) != NULL && entry.offset <= size && entry.size <= size - entry.offset
+            && (i == 0 || entryBefore(entries[i - 1], entry));
+    }
+    if (!valid)
+        close();
+    return valid;
+}
+
+void PakFile::close()
+{
+    mapping.close();
+    head = NULL;
+    entries = NULL;
+}
+
+bool PakFile::find(const string& name, const unsigned char*& bytes, size_t& length) const
+{
+    if (!head || name.size() >= (size_t)PAK_NAME_SIZE)
+        return false;
+    PakEntry key;
+    memset(&key, 0, sizeof(key));
+    strcpy(key.name, name.c_str());
+    const PakEntry* end = entries + head->count;
+    const PakEntry* entry = lower_bound(entries, end, key, entryBefore);
+    if (entry == end || strcmp(entry->name, key.name) != 0)
+        return false;
+    bytes = mapping.data() + entry->offset;
+    length = entry->size;
+    return true;
+}
+
+string defaultPakPath()
+{
+    char exe[4096];
+    ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (length > 0) {
+        string path(exe, length);
+        path = path.substr(0, path.rfind('/') + 1) + "gravity.pak";
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0)
+            return path;
+    }
+    return "gravity.pak";
+}
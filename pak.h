@@ -0,0 +1,71 @@
+#ifndef PAK_H
+#define PAK_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+/* .pak : every asset of the game in one file, built by mkpak and mapped */
+/* once at startup, so each asset is a pointer into the mapping instead of */
+/* a file to open and read. A PakHeader, then one PakEntry per asset sorted */
+/* by name, then the assets themselves, each starting on a PAK_ALIGNMENT */
+/* boundary */
+
+const uint32_t PAK_VERSION = 1;
+const int PAK_NAME_SIZE = 48; // Including the terminating zero
+const int PAK_ALIGNMENT = 16;
+
+struct PakHeader {
+    char magic[4]; // "GPAK"
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct PakEntry {
+    char name[PAK_NAME_SIZE]; // The asset's file name, without its directory
+    uint64_t offset; // From the start of the file
+    uint64_t size;
+};
+
+/* Pack files into a .pak, each under its name without the directory; false */
+/* with a message on stderr if a file cannot be read or two names clash */
+bool writePak(const char* file, const std::vector<std::string>& inputs);
+
+/* A .pak file mapped read-only; assets are used straight from the mapping */
+class PakFile {
+public:
+    PakFile();
+
+    /* False if the file is missing, truncated or not a version this code reads */
+    bool open(const char* file);
+    void close();
+    bool isOpen() const { return head != NULL; }
+
+    /* Bytes of the asset called name, false if the archive does not hold it */
+    bool find(const std::string& name, const unsigned char*& bytes, size_t& length) const;
+
+    int count() const { return head ? head->count : 0; }
+    const PakEntry& entry(int i) const { return entries[i]; }
+
+private:
+    PakFile(const PakFile&);
+    PakFile& operator=(const PakFile&);
+
+    MappedFile mapping;
+    const PakHeader* head;
+    const PakEntry* entries;
+};
+
+/* The game's archive, empty when none was found; assets missing from it */
+/* are read from loose files in the working directory */
+extern PakFile pak;
+
+/* gravity.pak next to the executable, so the game runs from any working */
+/* directory, or in the working directory if there is none there */
+std::string defaultPakPath();
+
+#endif
@@ -0,0 +1,121 @@
+#include "profiler.h"
+
+#include "renderqueue.h"
+
+Profiler profiler;
+
+static const int WINDOW_FRAMES = 30; // Frames averaged for each update of the numbers
+static const int GPU_TIMER_DEPTH = 32; // Room for every layer of a few frames in flight
+
+/* Phase the GPU work of each render layer belongs to, -1 for none */
+static int phaseOfLayer(int layer)
+{
+    switch (layer) {
+    case LAYER_BOARD:
+        return PROFILE_TILES;
+    case LAYER_OBJECTS:
+        return PROFILE_OBSTACLES;
+    case LAYER_PLAYER:
+        return PROFILE_PLAYER;
+    case LAYER_HUD:
+        return PROFILE_STATUS_BARS;
+    case LAYER_TEXT:
+        return PROFILE_HUD_TEXT;
+    default:
+        return -1;
+    }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Profiler::Profiler()
+    : on(false)
+    , gpuTimer(GPU_TIMER_DEPTH)
+    , frames(0)
+    , sumFrame(0)
+    , shownFrame(0)
+{
+    for (int p = 0; p < PROFILE_PHASES; p++)
+        sumCpu[p] = sumGpu[p] = shownCpu[p] = shownGpu[p] = 0;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    on = enabled;
+    renderQueue.setLayerTimer(on ? &gpuTimer : NULL);
+}
+
+void Profiler::release()
+{
+    setEnabled(false);
+    gpuTimer.release();
+}
+
+void Profiler::beginFrame()
+{
+    frameStart = std::chrono::steady_clock::now();
+}
+
+void Profiler::endFrame()
+{
+    if (!on)
+        return;
+    sumFrame += elapsedMs(frameStart);
+
+    // Results of earlier frames, whichever are ready; never waits on the GPU
+    std::vector<GpuSample> samples;
+    gpuTimer.collect(samples);
+    for (size_t i = 0; i < samples.size(); i++) {
+        int phase = phaseOfLayer(samples[i].tag);
+        if (phase >= 0)
+            sumGpu[phase] += samples[i].ms;
+    }
+
+    if (++frames < WINDOW_FRAMES)
+        return;
+    for (int p = 0; p < PROFILE_PHASES; p++) {
+        shownCpu[p] = sumCpu[p] / frames;
+        shownGpu[p] = sumGpu[p] / frames;
+        sumCpu[p] = sumGpu[p] = 0;
+    }
+    shownFrame = sumFrame / frames;
+    sumFrame = 0;
+    frames = 0;
+}
+
+void Profiler::addCpu(ProfilePhase phase, double ms)
+{
+    sumCpu[phase] += ms;
+}
+
+const char* Profiler::name(ProfilePhase phase)
+{
+    static const char* names[PROFILE_PHASES] = {
+        "simulation",
+        "hud text",
+        "status bars",
+        "tiles",
+        "obstacles",
+        "player",
+        "flush"
+    };
+    return names[phase];
+}
+
+ProfileScope::ProfileScope(ProfilePhase phase)
+    : phase(phase)
+    , timing(profiler.enabled())
+{
+    if (timing)
+        start = std::chrono::steady_clock::now();
+}
+
+void ProfileScope::stop()
+{
+    if (timing)
+        profiler.addCpu(phase, elapsedMs(start));
+    timing = false;
+}
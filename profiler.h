@@ -0,0 +1,73 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+
+#include "gputimer.h"
+
+/* Phases of a game frame the profiler breaks the time down into */
+enum ProfilePhase {
+    PROFILE_SIMULATION, // Stepping the game : movement, collision, pickups
+    PROFILE_HUD_TEXT,
+    PROFILE_STATUS_BARS, // Lives, health and loading bars
+    PROFILE_TILES, // Culling and uploading the board
+    PROFILE_OBSTACLES, // Coins and fires
+    PROFILE_PLAYER,
+    PROFILE_FLUSH, // Executing the render queue, CPU side only
+    PROFILE_PHASES
+};
+
+/* CPU time of each phase measured with scopes, GPU time of each phase */
+/* measured on the render queue's layers, both averaged over a short window */
+/* so the numbers can be read while they change */
+class Profiler {
+public:
+    Profiler();
+
+    bool enabled() const { return on; }
+    void setEnabled(bool enabled);
+
+    /* Bracket every frame; endFrame runs after the render queue was flushed */
+    void beginFrame();
+    void endFrame();
+
+    void addCpu(ProfilePhase phase, double ms);
+
+    /* Averages over the last window, in milliseconds per frame */
+    double cpu(ProfilePhase phase) const { return shownCpu[phase]; }
+    double gpu(ProfilePhase phase) const { return shownGpu[phase]; }
+    double frameCpu() const { return shownFrame; }
+
+    static const char* name(ProfilePhase phase);
+
+    /* Free the GPU queries; must run while the GL context is still current */
+    void release();
+
+private:
+    bool on;
+    GpuTimer gpuTimer;
+    std::chrono::steady_clock::time_point frameStart;
+
+    int frames; // Frames in the current window
+    double sumCpu[PROFILE_PHASES], sumGpu[PROFILE_PHASES], sumFrame;
+    double shownCpu[PROFILE_PHASES], shownGpu[PROFILE_PHASES], shownFrame;
+};
+
+extern Profiler profiler;
+
+/* Adds the time until the end of the enclosing block, or until stop(), to */
+/* a phase when the profiler is on */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase);
+    ~ProfileScope() { stop(); }
+
+    void stop();
+
+private:
+    ProfilePhase phase;
+    bool timing; // The profiler was on when the scope opened
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
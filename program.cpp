@@ -0,0 +1,351 @@
+#include "program.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdlib>
+#include <stdint.h>
+
+#include <sys/stat.h>
+
+#include "pak.h"
+
+using namespace std;
+
+/* Names of the well-known uniforms, in UniformID order */
+static const char* const UNIFORM_NAMES[UNIFORM_COUNT] = {
+    "MVP",
+    "VP",
+    "texSampler",
+    "tileScale",
+    "tileLift"
+};
+
+Program::Program()
+    : linked(false)
+{
+    for (int i = 0; i < UNIFORM_COUNT; i++)
+        known[i] = -1;
+}
+
+static GLint findVariable(const vector<ShaderVariable>& variables, const string& name)
+{
+    for (size_t i = 0; i < variables.size(); i++)
+        if (variables[i].name == name)
+            return variables[i].location;
+    return -1;
+}
+
+GLint Program::uniform(const string& name) const
+{
+    return findVariable(activeUniforms, name);
+}
+
+GLint Program::attribute(const string& name) const
+{
+    return findVariable(activeAttributes, name);
+}
+
+/* Strip the "[0]" the driver appends to array names */
+static string baseName(const char* name)
+{
+    string s(name);
+    size_t bracket = s.find('[');
+    if (bracket != string::npos)
+        s.erase(bracket);
+    return s;
+}
+
+void Program::reflect()
+{
+    GLuint id = program.id();
+    GLint count = 0, length = 0;
+    vector<char> name;
+
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length);
+    name.resize(max(length, 1));
+    for (GLint i = 0; i < count; i++) {
+        ShaderVariable variable;
+        glGetActiveUniform(id, i, (GLsizei)name.size(), NULL, &variable.size, &variable.type, &name[0]);
+        variable.name = baseName(&name[0]);
+        variable.location = glGetUniformLocation(id, &name[0]);
+        activeUniforms.push_back(variable);
+    }
+
+    glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &length);
+    name.resize(max(length, 1));
+    for (GLint i = 0; i < count; i++) {
+        ShaderVariable variable;
+        glGetActiveAttrib(id, i, (GLsizei)name.size(), NULL, &variable.size, &variable.type, &name[0]);
+        variable.name = baseName(&name[0]);
+        variable.location = glGetAttribLocation(id, &name[0]);
+        activeAttributes.push_back(variable);
+    }
+
+    for (int i = 0; i < UNIFORM_COUNT; i++)
+        known[i] = uniform(UNIFORM_NAMES[i]);
+}
+
+/* Read a whole shader, from the asset archive or else from its file; false */
+/* if it cannot be opened */
+static bool readShader(const char* path, string& code)
+{
+    const unsigned char* bytes;
+    size_t length;
+    if (pak.find(path, bytes, length)) {
+        code.assign((const char*)bytes, length);
+        return true;
+    }
+    ifstream stream(path, ios::in);
+    if (!stream.is_open()) {
+        cout << "Could not open shader " << path << endl;
+        return false;
+    }
+    stringstream contents;
+    contents << stream.rdbuf();
+    code = contents.str();
+    return true;
+}
+
+/* Compile one shader stage, printing the info log if it fails */
+static GLuint compileShader(GLenum type, const string& code, const char* path)
+{
+    GLuint shader = glCreateShader(type);
+    const char* source = code.c_str();
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint result = GL_FALSE, length = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+    if (result != GL_TRUE) {
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        vector<char> log(max(length, 1), '\0');
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+        cout << "Could not compile " << path << ":" << endl << &log[0] << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/* Linked programs are kept in the user's cache directory as driver */
+/* binaries, one file per program named after the hash of both sources and */
+/* of the driver */
+static const char CACHE_MAGIC[4] = { 'G', 'P', 'B', 'C' };
+
+struct CacheHeader {
+    char magic[4]; // "GPBC"
+    uint32_t format; // Binary format the driver reported
+    uint64_t key; // Guards against a file renamed by hand
+};
+
+/* 64-bit FNV-1a, continuing from hash */
+static uint64_t fnv1a(const string& text, uint64_t hash = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < text.size(); i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* A binary only loads on the driver that produced it, so the driver's */
+/* strings are part of the key */
+static uint64_t cacheKey(const string& vertex_code, const string& fragment_code, const string& driver)
+{
+    // The terminating zeros keep "ab" + "c" apart from "a" + "bc"
+    uint64_t hash = fnv1a(vertex_code);
+    hash = fnv1a(string(1, '\0'), hash);
+    hash = fnv1a(fragment_code, hash);
+    hash = fnv1a(string(1, '\0'), hash);
+    return fnv1a(driver, hash);
+}
+
+/* $XDG_CACHE_HOME/gravity, or ~/.cache/gravity when it is not set, so the */
+/* cache is the same whatever directory the game runs from; empty if there */
+/* is no home to put it in */
+static string cacheDirectory()
+{
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0] == '/')
+        return string(xdg) + "/gravity";
+    const char* home = getenv("HOME");
+    if (home && home[0] == '/')
+        return string(home) + "/.cache/gravity";
+    return "";
+}
+
+static string cachePath(const string& directory, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return directory + name;
+}
+
+/* Program binaries need GL 4.1 or ARB_get_program_binary, and a driver that */
+/* offers at least one format */
+static bool binaryCacheSupported()
+{
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+string programCacheDriver()
+{
+    if (!binaryCacheSupported())
+        return "";
+    string driver;
+    const GLenum strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < 3; i++) {
+        const GLubyte* value = glGetString(strings[i]);
+        driver += value ? (const char*)value : "";
+        driver += '\n';
+    }
+    return driver;
+}
+
+/* Read the cached binary of key; false if there is none */
+static bool readCachedProgram(uint64_t key, GLenum& format, vector<char>& binary)
+{
+    string directory = cacheDirectory();
+    if (directory.empty())
+        return false;
+    ifstream in(cachePath(directory, key).c_str(), ios::in | ios::binary);
+    CacheHeader header;
+    if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.key != key)
+        return false;
+    binary.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    format = header.format;
+    return !binary.empty();
+}
+
+/* Load a cached binary into id; false if the driver rejects it, e.g. after */
+/* a driver update */
+static bool loadCachedProgram(GLuint id, const ProgramSource& source)
+{
+    if (source.binary.empty())
+        return false;
+    glProgramBinary(id, source.binaryFormat, &source.binary[0], (GLsizei)source.binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(id, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+/* Write the binary of a freshly linked program under key; the file is */
+/* renamed into place so a half-written one is never loaded */
+static void storeCachedProgram(GLuint id, uint64_t key)
+{
+    string directory = cacheDirectory();
+    if (directory.empty())
+        return;
+    GLint length = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    vector<char> binary(length);
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.key = key;
+    GLenum format = 0;
+    glGetProgramBinary(id, length, NULL, &format, &binary[0]);
+    header.format = format;
+
+    // Create the directory and any missing parent, ~/.cache may not exist yet
+    for (size_t slash = directory.find('/', 1); slash != string::npos; slash = directory.find('/', slash + 1))
+        mkdir(directory.substr(0, slash).c_str(), 0755);
+    mkdir(directory.c_str(), 0755);
+    string path = cachePath(directory, key), temporary = path + ".tmp";
+    ofstream out(temporary.c_str(), ios::out | ios::binary | ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write(&binary[0], binary.size());
+    out.close();
+    if (!out || rename(temporary.c_str(), path.c_str()) != 0)
+        remove(temporary.c_str());
+}
+
+bool readProgram(const char* vertex_file_path, const char* fragment_file_path, const string& driver, ProgramSource& source)
+{
+    source.vertexPath = vertex_file_path;
+    source.fragmentPath = fragment_file_path;
+    source.key = 0;
+    source.binaryFormat = 0;
+    source.binary.clear();
+    if (!readShader(vertex_file_path, source.vertexCode) || !readShader(fragment_file_path, source.fragmentCode))
+        return false;
+    if (!driver.empty()) {
+        source.key = cacheKey(source.vertexCode, source.fragmentCode, driver);
+        readCachedProgram(source.key, source.binaryFormat, source.binary);
+    }
+    return true;
+}
+
+Program buildProgram(const ProgramSource& source)
+{
+    Program result;
+    const char* vertex_file_path = source.vertexPath.c_str();
+    const char* fragment_file_path = source.fragmentPath.c_str();
+
+    result.program.create();
+    GLuint id = result.program.id();
+    bool cache = source.key != 0;
+    if (loadCachedProgram(id, source)) {
+        result.linked = true;
+        result.reflect();
+        return result;
+    }
+
+    // Cache miss or a rejected binary : build from the sources
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, source.vertexCode, vertex_file_path);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, source.fragmentCode, fragment_file_path);
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        result.program.reset();
+        return result;
+    }
+
+    if (cache)
+        glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(id, vertexShader);
+    glAttachShader(id, fragmentShader);
+    glLinkProgram(id);
+    // The program keeps the compiled code, the shaders are no longer needed
+    glDetachShader(id, vertexShader);
+    glDetachShader(id, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE, length = 0;
+    glGetProgramiv(id, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+        vector<char> log(max(length, 1), '\0');
+        glGetProgramInfoLog(id, (GLsizei)log.size(), NULL, &log[0]);
+        cout << "Could not link " << vertex_file_path << " with " << fragment_file_path << ":" << endl << &log[0] << endl;
+        result.program.reset();
+        return result;
+    }
+
+    if (cache)
+        storeCachedProgram(id, source.key);
+    result.linked = true;
+    result.reflect();
+    return result;
+}
+
+Program LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
+{
+    ProgramSource source;
+    if (!readProgram(vertex_file_path, fragment_file_path, programCacheDriver(), source))
+        return Program();
+    return buildProgram(source);
+}
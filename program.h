@@ -0,0 +1,91 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glresource.h"
+
+/* Uniforms the game's shaders share; their locations are resolved once */
+/* at link time so draws never look a name up */
+enum UniformID {
+    UNIFORM_MVP,
+    UNIFORM_VP,
+    UNIFORM_TEX_SAMPLER,
+    UNIFORM_TILE_SCALE,
+    UNIFORM_TILE_LIFT,
+    UNIFORM_COUNT
+};
+
+/* One active uniform or attribute as reported by the driver */
+struct ShaderVariable {
+    std::string name; // Arrays are listed without their "[0]"
+    GLint location;
+    GLenum type;
+    GLint size;
+};
+
+struct ProgramSource;
+
+/* A linked shader program and everything it exposes */
+class Program {
+public:
+    Program();
+
+    /* False if a shader failed to compile or the program failed to link */
+    bool valid() const { return linked; }
+
+    GLuint id() const { return program.id(); }
+
+    /* Location of a well-known uniform, -1 if the program does not use it */
+    GLint location(UniformID uniform) const { return known[uniform]; }
+
+    /* Location of any active uniform or attribute, -1 if it is not active */
+    GLint uniform(const std::string& name) const;
+    GLint attribute(const std::string& name) const;
+
+    const std::vector<ShaderVariable>& uniforms() const { return activeUniforms; }
+    const std::vector<ShaderVariable>& attributes() const { return activeAttributes; }
+
+private:
+    friend Program buildProgram(const ProgramSource& source);
+
+    void reflect();
+
+    GLProgram program;
+    bool linked;
+    std::vector<ShaderVariable> activeUniforms;
+    std::vector<ShaderVariable> activeAttributes;
+    GLint known[UNIFORM_COUNT];
+};
+
+/* Compile and link a program from a vertex and a fragment shader file */
+/* Compile and link errors are printed along with the file they came from */
+Program LoadShaders(const char* vertex_file_path, const char* fragment_file_path);
+
+/* Everything LoadShaders reads from disk : both sources and the cached */
+/* binary of the pair, if there is one */
+struct ProgramSource {
+    std::string vertexPath, fragmentPath;
+    std::string vertexCode, fragmentCode;
+    uint64_t key; // Names the cached binary, 0 when the cache is not used
+    GLenum binaryFormat;
+    std::vector<char> binary; // Empty if nothing was cached
+};
+
+/* The driver's identity as the binary cache keys it, empty if the driver */
+/* cannot hand out program binaries; needs the GL thread */
+std::string programCacheDriver();
+
+/* Read both shaders and the binary cached for them on driver; false if a */
+/* shader cannot be opened. Touches no GL, so it can run on any thread */
+bool readProgram(const char* vertex_file_path, const char* fragment_file_path, const std::string& driver, ProgramSource& source);
+
+/* Load the cached binary of source or else compile and link it, caching */
+/* the result; the GL half of LoadShaders */
+Program buildProgram(const ProgramSource& source);
+
+#endif
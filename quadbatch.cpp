@@ -0,0 +1,53 @@
+#include "quadbatch.h"
+
+/* Floats per vertex : x, y, r, g, b, s, t, layer */
+static const int VERTEX_FLOATS = 8;
+
+QuadBatch::QuadBatch()
+    : dirty(true)
+{
+}
+
+void QuadBatch::addQuad(float x0, float y0, float x1, float y1, const glm::vec3& color, float u0, float v0, float u1, float v1, float layer)
+{
+    const GLfloat quad[6][4] = {
+        { x0, y0, u0, v1 },
+        { x1, y0, u1, v1 },
+        { x1, y1, u1, v0 },
+        { x1, y1, u1, v0 },
+        { x0, y1, u0, v0 },
+        { x0, y0, u0, v1 }
+    };
+    for (int v = 0; v < 6; v++) {
+        GLfloat vertex[VERTEX_FLOATS] = { quad[v][0], quad[v][1], color.x, color.y, color.z, quad[v][2], quad[v][3], layer };
+        vertices.insert(vertices.end(), vertex, vertex + VERTEX_FLOATS);
+    }
+}
+
+struct VAO* QuadBatch::upload()
+{
+    if (!vao.VertexArray.id()) {
+        vao.VertexArray.create();
+        vao.VertexBuffer.create();
+        glBindVertexArray(vao.VertexArray.id());
+        glBindBuffer(GL_ARRAY_BUFFER, vao.VertexBuffer.id());
+        GLsizei stride = VERTEX_FLOATS * sizeof(GLfloat);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0); // attribute 0. Position (x,y)
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(GLfloat))); // attribute 1. Color (r,g,b)
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(GLfloat))); // attribute 2. Texture (s,t,layer), a 2D texture ignores the layer
+        glEnableVertexAttribArray(2);
+    }
+    vao.VertexBuffer.upload(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.empty() ? NULL : &vertices[0], GL_DYNAMIC_DRAW);
+    vao.NumVertices = (int)(vertices.size() / VERTEX_FLOATS);
+    dirty = false;
+    return &vao;
+}
+
+void QuadBatch::release()
+{
+    vao.VertexBuffer.reset();
+    vao.VertexArray.reset();
+    dirty = true;
+}
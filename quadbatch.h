@@ -0,0 +1,36 @@
+#ifndef QUADBATCH_H
+#define QUADBATCH_H
+
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "globjects.h"
+
+/* Textured, tinted rectangles drawn together with one draw call; what */
+/* TextBatch and SpriteBatch share. A batch marks itself dirty when one of */
+/* its elements changes and only then rebuilds its quads and uploads them. */
+/* Vertices are x, y, r, g, b, s, t, layer. */
+class QuadBatch {
+public:
+    /* Free the GPU objects; must run while the GL context is still current */
+    void release();
+
+protected:
+    QuadBatch();
+
+    /* Append the rectangle from (x0, y0) to (x1, y1), (u0, v0) being the */
+    /* texture coordinates of its top left corner and (u1, v1) of its bottom right */
+    void addQuad(float x0, float y0, float x1, float y1, const glm::vec3& color, float u0, float v0, float u1, float v1, float layer = 0);
+
+    /* Upload the quads added since vertices was last cleared, creating the */
+    /* VAO on first use, and return it */
+    struct VAO* upload();
+
+    std::vector<GLfloat> vertices;
+    struct VAO vao;
+    bool dirty;
+};
+
+#endif
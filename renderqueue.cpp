@@ -0,0 +1,151 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+
+RenderQueue renderQueue;
+
+static DrawItem makeItem(DrawKind kind, unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& matrix)
+{
+    DrawItem item;
+    item.kind = kind;
+    item.layer = layer;
+    item.program = program;
+    item.texture = 0;
+    item.target = GL_TEXTURE_2D;
+    item.vao = vao;
+    item.matrixLocation = matrixLocation;
+    item.matrix = matrix;
+    item.numFloats = 0;
+    return item;
+}
+
+DrawItem DrawItem::mesh(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& MVP)
+{
+    return makeItem(DRAW_MESH, layer, program, matrixLocation, vao, MVP);
+}
+
+DrawItem DrawItem::textured(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& MVP, GLenum target)
+{
+    DrawItem item = makeItem(DRAW_TEXTURED_MESH, layer, program, matrixLocation, vao, MVP);
+    item.texture = vao->TextureID;
+    item.target = target;
+    return item;
+}
+
+DrawItem DrawItem::instanced(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& VP)
+{
+    return makeItem(DRAW_INSTANCED_MESH, layer, program, matrixLocation, vao, VP);
+}
+
+DrawItem& DrawItem::uniform(GLint location, float value)
+{
+    if (numFloats < MAX_FLOATS) {
+        floatLocation[numFloats] = location;
+        floatValue[numFloats] = value;
+        numFloats++;
+    }
+    return *this;
+}
+
+RenderQueue::RenderQueue()
+    : layerTimer(NULL)
+{
+}
+
+void RenderQueue::submit(const DrawItem& item)
+{
+    items.push_back(item);
+}
+
+/* Order of execution; ties keep their submission order (stable sort) */
+static bool drawOrder(const DrawItem& a, const DrawItem& b)
+{
+    if (a.layer != b.layer)
+        return a.layer < b.layer;
+    if (a.program != b.program)
+        return a.program < b.program;
+    if (a.texture != b.texture)
+        return a.texture < b.texture;
+    return a.vao < b.vao;
+}
+
+void RenderQueue::flush()
+{
+    std::stable_sort(items.begin(), items.end(), drawOrder);
+
+    // Values that can never be a real binding, so the first draw sets everything
+    GLuint program = ~0u, texture = ~0u;
+    GLenum target = GL_NONE;
+    struct VAO* vao = NULL;
+    GLenum fillMode = GL_NONE;
+
+    last.draws = 0;
+    last.stateChanges = 0;
+    last.stateChangesAvoided = 0;
+
+    for (size_t i = 0; i < items.size(); i++) {
+        const DrawItem& item = items[i];
+        last.draws++;
+
+        if (layerTimer && (i == 0 || item.layer != items[i - 1].layer)) {
+            if (i > 0)
+                layerTimer->end();
+            layerTimer->begin(item.layer);
+        }
+
+        if (item.program != program) {
+            glUseProgram(item.program);
+            program = item.program;
+            last.stateChanges++;
+        }
+        else
+            last.stateChangesAvoided++;
+
+        if (item.kind == DRAW_TEXTURED_MESH) {
+            if (item.texture != texture || item.target != target) {
+                glBindTexture(item.target, item.texture);
+                texture = item.texture;
+                target = item.target;
+                last.stateChanges++;
+            }
+            else
+                last.stateChangesAvoided++;
+        }
+
+        glUniformMatrix4fv(item.matrixLocation, 1, GL_FALSE, &item.matrix[0][0]);
+        for (int f = 0; f < item.numFloats; f++)
+            glUniform1f(item.floatLocation[f], item.floatValue[f]);
+
+        if (item.vao->FillMode != fillMode) {
+            glPolygonMode(GL_FRONT_AND_BACK, item.vao->FillMode);
+            fillMode = item.vao->FillMode;
+            last.stateChanges++;
+        }
+        else
+            last.stateChangesAvoided++;
+
+        if (item.vao != vao) {
+            glBindVertexArray(item.vao->VertexArray.id());
+            vao = item.vao;
+            last.stateChanges++;
+        }
+        else
+            last.stateChangesAvoided++;
+
+        const struct VAO* mesh = item.vao;
+        if (mesh->NumIndices > 0) {
+            if (item.kind == DRAW_INSTANCED_MESH)
+                glDrawElementsInstanced(mesh->PrimitiveMode, mesh->NumIndices, GL_UNSIGNED_SHORT, (void*)0, mesh->NumInstances);
+            else
+                glDrawElements(mesh->PrimitiveMode, mesh->NumIndices, GL_UNSIGNED_SHORT, (void*)0);
+        }
+        else if (item.kind == DRAW_INSTANCED_MESH)
+            glDrawArraysInstanced(mesh->PrimitiveMode, 0, mesh->NumVertices, mesh->NumInstances);
+        else
+            glDrawArrays(mesh->PrimitiveMode, 0, mesh->NumVertices);
+    }
+    if (layerTimer && !items.empty())
+        layerTimer->end();
+
+    items.clear();
+}
@@ -0,0 +1,88 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "globjects.h"
+#include "gputimer.h"
+
+/* Draws in a lower layer are always executed before draws in a higher one. */
+/* Inside a layer the queue is free to reorder draws to share state. */
+enum RenderLayer {
+    LAYER_BACKGROUND,
+    LAYER_BOARD,
+    LAYER_OBJECTS,
+    LAYER_PLAYER,
+    LAYER_HUD,
+    LAYER_TEXT
+};
+
+enum DrawKind {
+    DRAW_MESH, // Colored VAO
+    DRAW_TEXTURED_MESH, // VAO with its texture bound to unit 0, as a 2D texture or an array of them
+    DRAW_INSTANCED_MESH // Every instance of the VAO in one call
+};
+
+/* One draw submitted by a screen, with everything needed to execute it later */
+struct DrawItem {
+    static const int MAX_FLOATS = 2;
+
+    DrawKind kind;
+    unsigned layer;
+    GLuint program;
+    GLuint texture;
+    GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+    struct VAO* vao;
+
+    GLint matrixLocation;
+    glm::mat4 matrix;
+
+    // Extra float uniforms, used by the instanced tiles
+    int numFloats;
+    GLint floatLocation[MAX_FLOATS];
+    float floatValue[MAX_FLOATS];
+
+    static DrawItem mesh(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& MVP);
+    static DrawItem textured(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& MVP, GLenum target = GL_TEXTURE_2D);
+    static DrawItem instanced(unsigned layer, GLuint program, GLint matrixLocation, struct VAO* vao, const glm::mat4& VP);
+
+    /* Attach an extra float uniform to the draw */
+    DrawItem& uniform(GLint location, float value);
+};
+
+/* Per-frame counters of the last flush */
+struct RenderStats {
+    int draws;
+    int stateChanges; // program, texture, VAO and fill mode changes actually issued
+    int stateChangesAvoided; // changes that per-draw binding would have issued but were already in place
+};
+
+/* Collects the draws of a frame, sorts them by layer, program, texture and */
+/* mesh, then executes them with only the state transitions that are needed */
+class RenderQueue {
+public:
+    RenderQueue();
+
+    void submit(const DrawItem& item);
+
+    /* Sort, execute and empty the queue */
+    void flush();
+
+    const RenderStats& stats() const { return last; }
+
+    /* Time the GPU work of each layer with timer, tagged with the layer; */
+    /* NULL (the default) to stop */
+    void setLayerTimer(GpuTimer* timer) { layerTimer = timer; }
+
+private:
+    std::vector<DrawItem> items;
+    RenderStats last;
+    GpuTimer* layerTimer;
+};
+
+extern RenderQueue renderQueue;
+
+#endif
@@ -0,0 +1,94 @@
+#include "resources.h"
+
+#include <iostream>
+
+#include "pak.h"
+
+using namespace std;
+
+ResourceCache resources;
+
+const Program* ResourceCache::program(const string& vertex_file, const string& fragment_file)
+{
+    string key = vertex_file + "|" + fragment_file;
+    map<string, Program>::iterator it = programs.find(key);
+    if (it != programs.end())
+        return &it->second;
+
+    Program& program = programs[key];
+    program = LoadShaders(vertex_file.c_str(), fragment_file.c_str());
+    return &program;
+}
+
+const Program* ResourceCache::program(const ProgramSource& source)
+{
+    string key = source.vertexPath + "|" + source.fragmentPath;
+    map<string, Program>::iterator it = programs.find(key);
+    if (it != programs.end())
+        return &it->second;
+
+    Program& program = programs[key];
+    program = buildProgram(source);
+    return &program;
+}
+
+struct VAO* ResourceCache::mesh(const string& name, MeshBuilder build)
+{
+    unique_ptr<struct VAO>& vao = meshes[name];
+    if (!vao) {
+        MeshData data;
+        build(data);
+        vao.reset(uploadColorMesh(data));
+    }
+    return vao.get();
+}
+
+struct VAO* ResourceCache::mesh(const string& name, const MeshData& data)
+{
+    unique_ptr<struct VAO>& vao = meshes[name];
+    if (!vao)
+        vao.reset(uploadColorMesh(data));
+    return vao.get();
+}
+
+GlyphAtlas* ResourceCache::font(const string& filename)
+{
+    unique_ptr<GlyphAtlas>& font = fonts[filename];
+    if (!font) {
+        font.reset(new GlyphAtlas());
+        const unsigned char* bytes;
+        size_t length;
+        bool loaded = pak.find(filename, bytes, length) ? font->load(bytes, length) : font->load(filename.c_str());
+        if (!loaded) {
+            cout << "Could not load font " << filename << endl;
+            fonts.erase(filename);
+            return NULL;
+        }
+    }
+    return font.get();
+}
+
+SpriteAtlas* ResourceCache::atlas(const string& filename)
+{
+    unique_ptr<SpriteAtlas>& atlas = atlases[filename];
+    if (!atlas) {
+        atlas.reset(new SpriteAtlas());
+        const unsigned char* bytes;
+        size_t length;
+        bool loaded = pak.find(filename, bytes, length) ? atlas->load(bytes, length) : atlas->load(filename.c_str());
+        if (!loaded) {
+            cout << "Could not load sprite atlas " << filename << endl;
+            atlases.erase(filename);
+            return NULL;
+        }
+    }
+    return atlas.get();
+}
+
+void ResourceCache::clear()
+{
+    programs.clear();
+    meshes.clear();
+    fonts.clear();
+    atlases.clear();
+}
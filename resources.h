@@ -0,0 +1,52 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "globjects.h"
+#include "program.h"
+#include "sprites.h"
+#include "textrenderer.h"
+
+/* Owns every sprite atlas, shader program, mesh and font the game uses. */
+/* Each resource is created the first time it is asked for and the same */
+/* handle is returned on every later request, so switching screens never */
+/* compiles or uploads anything twice. */
+class ResourceCache {
+public:
+    typedef void (*MeshBuilder)(MeshData& mesh);
+
+    /* Program linked from a vertex and a fragment shader file */
+    const Program* program(const std::string& vertex_file, const std::string& fragment_file);
+
+    /* The same program, from shaders the asset loader has read already */
+    const Program* program(const ProgramSource& source);
+
+    /* Mesh registered under name, built by build on first use */
+    struct VAO* mesh(const std::string& name, MeshBuilder build);
+
+    /* The same mesh, from vertices the asset loader has built already */
+    struct VAO* mesh(const std::string& name, const MeshData& data);
+
+    /* Glyph atlas rasterized from a TrueType file, NULL if it could not be loaded */
+    GlyphAtlas* font(const std::string& filename);
+
+    /* Sprite atlas uploaded from a .gatlas file, NULL if it could not be loaded */
+    SpriteAtlas* atlas(const std::string& filename);
+
+    /* Free every resource, the cache is empty afterwards */
+    /* Must run while the GL context is still current */
+    void clear();
+
+private:
+    std::map<std::string, Program> programs;
+    std::map<std::string, std::unique_ptr<struct VAO> > meshes;
+    std::map<std::string, std::unique_ptr<GlyphAtlas> > fonts;
+    std::map<std::string, std::unique_ptr<SpriteAtlas> > atlases;
+};
+
+extern ResourceCache resources;
+
+#endif
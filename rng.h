@@ -0,0 +1,58 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* Small, fast and fully deterministic random numbers for the simulation : */
+/* PCG32 (XSH RR), 64 bits of state and 32 bits per draw. The same seed */
+/* gives the same sequence on every platform, unlike rand(). */
+class Rng {
+public:
+    explicit Rng(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed)
+    {
+        state = 0;
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + INCREMENT;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    /* Uniform in [0, n) for n > 0, without the bias of next() % n */
+    uint32_t below(uint32_t n)
+    {
+        // Lemire's multiply and shift, rejecting the few draws that would favour low values
+        uint64_t m = (uint64_t)next() * n;
+        if ((uint32_t)m < n) {
+            uint32_t threshold = (uint32_t)(-n) % n;
+            while ((uint32_t)m < threshold)
+                m = (uint64_t)next() * n;
+        }
+        return (uint32_t)(m >> 32);
+    }
+
+private:
+    static const uint64_t INCREMENT = 1442695040888963407ULL;
+    uint64_t state;
+};
+
+/* Derive an unrelated seed from a seed and a small number (level, game), */
+/* with the SplitMix64 finaliser so seeds n and n + 1 share no pattern */
+inline uint64_t mixSeed(uint64_t seed, uint64_t n)
+{
+    uint64_t z = seed + (n + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+#endif
@@ -0,0 +1,169 @@
+#include "sprites.h"
+
+#include <cstring>
+
+using namespace std;
+
+/* Bytes of one layer of a level */
+static size_t layerBytes(const GatlasLevel& level)
+{
+    return (size_t)level.width * level.height * 3;
+}
+
+bool SpriteAtlas::load(const char* file_name)
+{
+    return file.open(file_name) && allocate();
+}
+
+bool SpriteAtlas::load(const unsigned char* data, size_t size)
+{
+    return file.open(data, size) && allocate();
+}
+
+bool SpriteAtlas::allocate()
+{
+    const GatlasHeader& header = file.header();
+    sprites.clear();
+    for (uint32_t i = 0; i < header.sprites; i++) {
+        const GatlasSprite& entry = file.sprite(i);
+        Sprite sprite;
+        sprite.layer = entry.layer;
+        sprite.u0 = (float)entry.x / header.width;
+        sprite.v0 = (float)entry.y / header.height;
+        sprite.u1 = (float)(entry.x + entry.width) / header.width;
+        sprite.v1 = (float)(entry.y + entry.height) / header.height;
+        sprites[entry.name] = sprite;
+    }
+
+    // Storage for every level of every layer, the pixels come with upload()
+    array.create();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.id());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < header.levels; i++) {
+        const GatlasLevel& level = file.level(i);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGB, level.width, level.height, header.layers, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        bytes += level.bytes;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    array.setBytes(bytes);
+    uploaded.assign(header.layers, false);
+    return true;
+}
+
+void SpriteAtlas::upload(int layer, GLuint pixel_buffer)
+{
+    if (uploaded[layer])
+        return;
+    uploaded[layer] = true;
+
+    const GatlasHeader& header = file.header();
+    vector<const unsigned char*> sources(header.levels);
+    size_t total = 0;
+    for (uint32_t i = 0; i < header.levels; i++) {
+        sources[i] = file.pixels(i) + layer * layerBytes(file.level(i));
+        total += layerBytes(file.level(i));
+    }
+    // Offsets into the pixel buffer if it could be filled, else client pointers
+    vector<const unsigned char*> bases = sources;
+    if (pixel_buffer) {
+        // Orphan the buffer so a copy still in flight never stalls the write,
+        // then let the driver pull the pixels from it on its own time
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, total, NULL, GL_STREAM_DRAW);
+        unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            size_t offset = 0;
+            for (uint32_t i = 0; i < header.levels; i++) {
+                memcpy(mapped + offset, sources[i], layerBytes(file.level(i)));
+                bases[i] = (const unsigned char*)NULL + offset;
+                offset += layerBytes(file.level(i));
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.id());
+    // Rows are tightly packed, not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < header.levels; i++) {
+        const GatlasLevel& level = file.level(i);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1, GL_RGB, GL_UNSIGNED_BYTE, bases[i]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void SpriteAtlas::prefetch(int layer) const
+{
+    // A read a page faults the whole layer into memory
+    const GatlasHeader& header = file.header();
+    unsigned sum = 0;
+    for (uint32_t i = 0; i < header.levels; i++) {
+        const unsigned char* pixels = file.pixels(i) + layer * layerBytes(file.level(i));
+        for (size_t offset = 0; offset < layerBytes(file.level(i)); offset += 4096)
+            sum += pixels[offset];
+    }
+    volatile unsigned sink = sum;
+    (void)sink;
+}
+
+const SpriteAtlas::Sprite* SpriteAtlas::sprite(const string& name) const
+{
+    map<string, Sprite>::const_iterator found = sprites.find(name);
+    return found == sprites.end() ? NULL : &found->second;
+}
+
+int SpriteBatch::add(const char* sprite, float x, float y, float width, float height, const glm::vec3& color)
+{
+    Entry entry = { sprite, x, y, width, height, color, true };
+    entries.push_back(entry);
+    dirty = true;
+    return (int)entries.size() - 1;
+}
+
+void SpriteBatch::place(int slot, float x, float y, float width, float height)
+{
+    Entry& entry = entries[slot];
+    if (entry.x == x && entry.y == y && entry.width == width && entry.height == height)
+        return;
+    entry.x = x;
+    entry.y = y;
+    entry.width = width;
+    entry.height = height;
+    dirty = true;
+}
+
+void SpriteBatch::show(int slot, bool visible)
+{
+    if (entries[slot].visible == visible)
+        return;
+    entries[slot].visible = visible;
+    dirty = true;
+}
+
+struct VAO* SpriteBatch::prepare(SpriteAtlas& atlas)
+{
+    vao.TextureID = atlas.texture();
+    if (!dirty)
+        return &vao;
+
+    vertices.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        const SpriteAtlas::Sprite* s = atlas.sprite(entry.sprite);
+        if (s)
+            atlas.upload((int)s->layer);
+        if (!entry.visible || !s)
+            continue;
+        addQuad(entry.x - entry.width / 2, entry.y - entry.height / 2, entry.x + entry.width / 2, entry.y + entry.height / 2, entry.color, s->u0, s->v0, s->u1, s->v1, s->layer);
+    }
+    return upload();
+}
@@ -0,0 +1,94 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "atlas.h"
+#include "globjects.h"
+#include "quadbatch.h"
+
+/* The UI images of a .gatlas as one array texture, each image a */
+/* sub-rectangle of one layer. Loading only allocates the texture; the */
+/* pixels of a layer go up the first time one of its sprites is drawn, or */
+/* earlier through the asset loader, so a screen never waits on the images */
+/* of the others */
+class SpriteAtlas {
+public:
+    struct Sprite {
+        float layer;
+        float u0, v0, u1, v1; // v0 is the top row of the image
+    };
+
+    SpriteAtlas() {}
+
+    /* Map a .gatlas file and allocate its texture, false if it could not be read */
+    bool load(const char* file);
+
+    /* Same, from a .gatlas already in memory; data must outlive the atlas */
+    bool load(const unsigned char* data, size_t size);
+
+    /* NULL if the atlas has no sprite called name */
+    const Sprite* sprite(const std::string& name) const;
+    GLuint texture() const { return array.id(); }
+
+    bool resident(int layer) const { return uploaded[layer]; }
+
+    /* Upload the pixels of a layer, every mip level, unless they are up */
+    /* already; staged through pixel_buffer when it is not 0 */
+    void upload(int layer, GLuint pixel_buffer = 0);
+
+    /* Read through the pixels of a layer so its upload does not wait on */
+    /* the disk; touches no GL state, for the loader thread */
+    void prefetch(int layer) const;
+
+private:
+    SpriteAtlas(const SpriteAtlas&);
+    SpriteAtlas& operator=(const SpriteAtlas&);
+
+    bool allocate();
+
+    AtlasFile file; // Kept open, the layers are uploaded from it
+    std::map<std::string, Sprite> sprites;
+    std::vector<bool> uploaded;
+    GLTexture array;
+};
+
+/* The 2D elements of a screen, each a sprite of the atlas stretched over a */
+/* rectangle and tinted by a color, drawn together with one draw call. */
+/* Later sprites cover earlier ones. The vertex buffer is only rebuilt when */
+/* a sprite actually moves, appears or disappears. */
+class SpriteBatch : public QuadBatch {
+public:
+    bool empty() const { return entries.empty(); }
+
+    /* Add a sprite centered on (x, y); returns a slot for place() and show() */
+    int add(const char* sprite, float x, float y, float width, float height, const glm::vec3& color = glm::vec3(1.0f));
+
+    /* Move and resize the sprite of a slot */
+    void place(int slot, float x, float y, float width, float height);
+
+    /* Hidden sprites are left out of the draw */
+    void show(int slot, bool visible);
+
+    /* Rebuild the vertices if anything changed and return the VAO to draw; */
+    /* uploads the atlas layers of the batch's sprites, shown or not, that */
+    /* are not up yet */
+    struct VAO* prepare(SpriteAtlas& atlas);
+
+private:
+    struct Entry {
+        std::string sprite;
+        float x, y, width, height;
+        glm::vec3 color;
+        bool visible;
+    };
+
+    std::vector<Entry> entries;
+};
+
+#endif
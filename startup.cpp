@@ -0,0 +1,75 @@
+#include "startup.h"
+
+#include <iomanip>
+
+StartupTimeline startup;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+StartupTimeline::StartupTimeline()
+    : launch(std::chrono::steady_clock::now())
+{
+    for (int p = 0; p < STARTUP_PHASES; p++)
+        phases[p] = 0;
+    for (int m = 0; m < STARTUP_MILESTONES; m++)
+        at[m] = -1;
+}
+
+void StartupTimeline::add(StartupPhase phase, double ms)
+{
+    phases[phase] += ms;
+}
+
+void StartupTimeline::mark(StartupMilestone milestone)
+{
+    if (!reached(milestone))
+        at[milestone] = elapsedMs(launch);
+}
+
+void StartupTimeline::report(std::ostream& out) const
+{
+    out << std::fixed << std::setprecision(1) << "startup, ms since launch:" << std::endl;
+    for (int m = 0; m < STARTUP_MILESTONES; m++)
+        if (reached((StartupMilestone)m))
+            out << "  " << std::left << std::setw(14) << name((StartupMilestone)m) << std::right << std::setw(8) << at[m] << std::endl;
+    out << "by subsystem, ms:" << std::endl;
+    for (int p = 0; p < STARTUP_PHASES; p++)
+        out << "  " << std::left << std::setw(14) << name((StartupPhase)p) << std::right << std::setw(8) << phases[p] << std::endl;
+    out << std::defaultfloat << std::setprecision(6);
+}
+
+const char* StartupTimeline::name(StartupPhase phase)
+{
+    static const char* names[STARTUP_PHASES] = {
+        "archive",
+        "window",
+        "shaders",
+        "font",
+        "textures"
+    };
+    return names[phase];
+}
+
+const char* StartupTimeline::name(StartupMilestone milestone)
+{
+    static const char* names[STARTUP_MILESTONES] = {
+        "window",
+        "first frame",
+        "interactive"
+    };
+    return names[milestone];
+}
+
+StartupScope::StartupScope(StartupPhase phase)
+    : phase(phase)
+    , start(std::chrono::steady_clock::now())
+{
+}
+
+StartupScope::~StartupScope()
+{
+    startup.add(phase, elapsedMs(start));
+}
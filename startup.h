@@ -0,0 +1,62 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <chrono>
+#include <ostream>
+
+/* Subsystems the startup time is broken down into */
+enum StartupPhase {
+    STARTUP_ARCHIVE, // Mapping gravity.pak
+    STARTUP_WINDOW, // Window or offscreen context, GL loader
+    STARTUP_SHADERS,
+    STARTUP_FONT, // Rasterizing the glyph atlas
+    STARTUP_TEXTURES, // Uploading the start menu's layers of the UI sprite atlas
+    STARTUP_PHASES
+};
+
+/* Points on the way from launch to a usable start menu */
+enum StartupMilestone {
+    STARTUP_WINDOW_UP, // The GL context is current
+    STARTUP_FIRST_FRAME, // The first frame was presented
+    STARTUP_INTERACTIVE, // Input is being handled on the start menu
+    STARTUP_MILESTONES
+};
+
+/* Wall-clock time of each milestone since the process started, and the time */
+/* each subsystem took on the way */
+class StartupTimeline {
+public:
+    StartupTimeline();
+
+    void add(StartupPhase phase, double ms);
+
+    /* Stamp a milestone the first time it is reached, later calls are ignored */
+    void mark(StartupMilestone milestone);
+    bool reached(StartupMilestone milestone) const { return at[milestone] >= 0; }
+
+    /* The milestones reached and the subsystem totals, in milliseconds */
+    void report(std::ostream& out) const;
+
+    static const char* name(StartupPhase phase);
+    static const char* name(StartupMilestone milestone);
+
+private:
+    std::chrono::steady_clock::time_point launch; // Static initialization, as close to exec as we get
+    double phases[STARTUP_PHASES];
+    double at[STARTUP_MILESTONES]; // -1 until reached
+};
+
+extern StartupTimeline startup;
+
+/* Adds the time until the end of the enclosing block to a subsystem */
+class StartupScope {
+public:
+    explicit StartupScope(StartupPhase phase);
+    ~StartupScope();
+
+private:
+    StartupPhase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "textrenderer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+using namespace std;
+
+/* Width of the atlas texture and the gap left around every glyph */
+static const int ATLAS_WIDTH = 1024;
+static const int GLYPH_PADDING = 2;
+
+GlyphAtlas::GlyphAtlas()
+{
+    memset(glyphs, 0, sizeof(glyphs));
+}
+
+bool GlyphAtlas::load(const char* fontfile, int pixel_size)
+{
+    FT_Library library;
+    if (FT_Init_FreeType(&library))
+        return false;
+
+    FT_Face face;
+    bool loaded = false;
+    if (FT_New_Face(library, fontfile, 0, &face) == 0) {
+        loaded = rasterize(face, pixel_size);
+        FT_Done_Face(face);
+    }
+    FT_Done_FreeType(library);
+    return loaded;
+}
+
+bool GlyphAtlas::load(const unsigned char* data, size_t size, int pixel_size)
+{
+    FT_Library library;
+    if (FT_Init_FreeType(&library))
+        return false;
+
+    FT_Face face;
+    bool loaded = false;
+    if (FT_New_Memory_Face(library, data, (FT_Long)size, 0, &face) == 0) {
+        loaded = rasterize(face, pixel_size);
+        FT_Done_Face(face);
+    }
+    FT_Done_FreeType(library);
+    return loaded;
+}
+
+bool GlyphAtlas::rasterize(FT_Face face, int pixel_size)
+{
+    if (FT_Set_Pixel_Sizes(face, 0, pixel_size))
+        return false;
+
+    // Shelf packing : glyphs go left to right, a new row starts when one is full
+    struct Placement {
+        int x, y;
+    } placement[LAST_CHAR - FIRST_CHAR + 1];
+    int pen_x = GLYPH_PADDING, pen_y = GLYPH_PADDING, row_height = 0;
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        if (FT_Load_Char(face, c, FT_LOAD_DEFAULT))
+            continue;
+        int w = (face->glyph->metrics.width >> 6) + 1;
+        int h = (face->glyph->metrics.height >> 6) + 1;
+        if (pen_x + w + GLYPH_PADDING > ATLAS_WIDTH) {
+            pen_x = GLYPH_PADDING;
+            pen_y += row_height + GLYPH_PADDING;
+            row_height = 0;
+        }
+        placement[c - FIRST_CHAR].x = pen_x;
+        placement[c - FIRST_CHAR].y = pen_y;
+        pen_x += w + GLYPH_PADDING;
+        if (h > row_height)
+            row_height = h;
+    }
+    int atlas_height = 1;
+    while (atlas_height < pen_y + row_height + GLYPH_PADDING)
+        atlas_height *= 2;
+
+    vector<unsigned char> pixels((size_t)ATLAS_WIDTH * atlas_height, 0);
+    float em = (float)pixel_size;
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        Glyph& g = glyphs[c - FIRST_CHAR];
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+            continue;
+        FT_GlyphSlot slot = face->glyph;
+        const FT_Bitmap& bitmap = slot->bitmap;
+        int x = placement[c - FIRST_CHAR].x, y = placement[c - FIRST_CHAR].y;
+        for (unsigned row = 0; row < bitmap.rows; row++) {
+            if (y + (int)row >= atlas_height)
+                break;
+            unsigned columns = min((unsigned)bitmap.width, (unsigned)(ATLAS_WIDTH - x));
+            memcpy(&pixels[(size_t)(y + row) * ATLAS_WIDTH + x], bitmap.buffer + row * bitmap.pitch, columns);
+        }
+        g.left = slot->bitmap_left / em;
+        g.top = slot->bitmap_top / em;
+        g.width = bitmap.width / em;
+        g.height = bitmap.rows / em;
+        g.advance = (slot->advance.x >> 6) / em;
+        g.u0 = (float)x / ATLAS_WIDTH;
+        g.v0 = (float)y / atlas_height;
+        g.u1 = (float)(x + bitmap.width) / ATLAS_WIDTH;
+        g.v1 = (float)(y + bitmap.rows) / atlas_height;
+    }
+
+    atlas.create();
+    glBindTexture(GL_TEXTURE_2D, atlas.id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows of a single channel texture are not 4 byte aligned
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    atlas.setBytes(pixels.size());
+    return true;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::glyph(char c) const
+{
+    if (c < FIRST_CHAR || c > LAST_CHAR)
+        return NULL;
+    return &glyphs[c - FIRST_CHAR];
+}
+
+int TextBatch::add(const char* text, float x, float y, float scale, const glm::vec3& color)
+{
+    Entry entry;
+    entry.text = text;
+    entry.x = x;
+    entry.y = y;
+    entry.scale = scale;
+    entry.color = color;
+    entries.push_back(entry);
+    dirty = true;
+    return (int)entries.size() - 1;
+}
+
+void TextBatch::set(int slot, const char* text, int length)
+{
+    size_t n = 0;
+    while ((length < 0 || (int)n < length) && text[n] != '\0')
+        n++;
+    Entry& entry = entries[slot];
+    if (entry.text.size() == n && entry.text.compare(0, n, text, n) == 0)
+        return;
+    entry.text.assign(text, n);
+    dirty = true;
+}
+
+struct VAO* TextBatch::prepare(const GlyphAtlas& atlas)
+{
+    vao.TextureID = atlas.texture();
+    if (!dirty)
+        return &vao;
+
+    vertices.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        float pen = entry.x;
+        for (size_t c = 0; c < entry.text.size(); c++) {
+            const GlyphAtlas::Glyph* g = atlas.glyph(entry.text[c]);
+            if (!g)
+                continue;
+            float x0 = pen + g->left * entry.scale;
+            float y1 = entry.y + g->top * entry.scale;
+            float x1 = x0 + g->width * entry.scale;
+            float y0 = y1 - g->height * entry.scale;
+            pen += g->advance * entry.scale;
+            if (g->width == 0)
+                continue;
+            addQuad(x0, y0, x1, y1, entry.color, g->u0, g->v0, g->u1, g->v1);
+        }
+    }
+    return upload();
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "globjects.h"
+#include "quadbatch.h"
+
+/* Printable ASCII glyphs of a TrueType font rasterized once into a */
+/* single-channel texture. Metrics are in em units, so a string drawn */
+/* with scale 1 is one unit tall, like FTGL with a face size of 1. */
+class GlyphAtlas {
+public:
+    static const int FIRST_CHAR = 32;
+    static const int LAST_CHAR = 126;
+
+    struct Glyph {
+        float left, top; // Offset of the bitmap from the pen position
+        float width, height; // Size of the bitmap
+        float advance; // How far the pen moves after the glyph
+        float u0, v0, u1, v1; // Texture coordinates of the bitmap
+    };
+
+    GlyphAtlas();
+
+    /* Rasterize the font at pixel_size pixels per em, false if it could not be loaded */
+    bool load(const char* fontfile, int pixel_size = 64);
+
+    /* Same, from a font file already in memory; data must outlive the call only */
+    bool load(const unsigned char* data, size_t size, int pixel_size = 64);
+
+    const Glyph* glyph(char c) const;
+    GLuint texture() const { return atlas.id(); }
+
+private:
+    bool rasterize(struct FT_FaceRec_* face, int pixel_size);
+
+    Glyph glyphs[LAST_CHAR - FIRST_CHAR + 1];
+    GLTexture atlas;
+};
+
+/* A set of strings drawn together with one draw call. The vertex buffer */
+/* is only rebuilt when one of the strings actually changes. */
+class TextBatch : public QuadBatch {
+public:
+    bool empty() const { return entries.empty(); }
+
+    /* Add a string at (x, y) with its baseline at y; returns a slot for set() */
+    int add(const char* text, float x, float y, float scale, const glm::vec3& color);
+
+    /* Change the string of a slot; at most length characters, stops at '\0' */
+    void set(int slot, const char* text, int length = -1);
+
+    /* Rebuild the vertices if anything changed and return the VAO to draw */
+    struct VAO* prepare(const GlyphAtlas& atlas);
+
+private:
+    struct Entry {
+        std::string text;
+        float x, y, scale;
+        glm::vec3 color;
+    };
+
+    std::vector<Entry> entries;
+};
+
+#endif